@@ -0,0 +1,44 @@
+#ifndef ANSWER_JOURNAL_H
+#define ANSWER_JOURNAL_H
+
+#include "common.h"
+#include <stdint.h>
+
+// Append-only journal of the exam server's sessions.
+//
+// Every change to a session, its start, each answer given or cleared and
+// its submission, is one fixed-size event in ANSWER_JOURNAL_FILE. Events
+// are buffered and written out with one fdatasync per sync interval, so
+// the cost of durability is shared by every candidate answering in that
+// interval; the server holds a reply back until the event behind it is on
+// disk, and answers it with an error if the sync fails. A failed write is
+// retried; a failed fdatasync stops the journal taking further events. On
+// restart the intact events are replayed to rebuild the sessions,
+// and a torn tail left by a crash is cut off. The journal keeps growing
+// until it is removed, which is safe once every session in it is over.
+
+#define ANSWER_EVENT_START 1
+#define ANSWER_EVENT_ANSWER 2
+#define ANSWER_EVENT_SUBMIT 3
+
+#define ANSWER_JOURNAL_DEFAULT_SYNC_MS 50
+
+typedef struct {
+    int64_t time_ms;        // Unix time of the change in milliseconds
+    int32_t student_id;     // Student and paper name the session
+    int32_t paper_id;
+    uint8_t kind;           // ANSWER_EVENT_*
+    uint8_t question;       // Position in the candidate's view, from 0
+    int8_t choice;          // Option slot shown, -1 if cleared
+    uint8_t reserved;
+    uint32_t check;         // FNV-1a of the fields above
+} AnswerEvent;
+
+bool answer_journal_open(bool (*apply)(const AnswerEvent *event, void *arg), void *arg);
+bool answer_journal_append(AnswerEvent *event);
+int answer_journal_sync_wait(int64_t now_ms);
+bool answer_journal_sync(void);
+void answer_journal_close(void);
+void answer_journal_set_sync_interval(int ms);
+
+#endif // ANSWER_JOURNAL_H
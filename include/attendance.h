@@ -0,0 +1,28 @@
+#ifndef ATTENDANCE_H
+#define ATTENDANCE_H
+
+#include "common.h"
+#include <stdint.h>
+
+// Non-interactive gate check-in.
+//
+// QR payloads are read one per line from stdin or a FIFO that any number of
+// scanners write to, and resolved through the student index. Every scan
+// that matches a student is appended to ATTENDANCE_FILE as a fixed-size
+// event; a repeat scan of someone already checked in today is flagged as a
+// duplicate. Events are written in batches and synced at least once a
+// second, and rolling throughput is printed at the same interval. Each
+// scanner writes a payload and its newline in one write, which a FIFO
+// keeps whole; a line still unfinished after a second is rejected.
+
+#define ATTENDANCE_DUPLICATE 0x1
+
+typedef struct {
+    int64_t time_ms;        // Unix time of the scan in milliseconds
+    int32_t student_id;
+    int32_t flags;          // ATTENDANCE_DUPLICATE
+} AttendanceEvent;
+
+bool run_checkin_stream(const char *path);
+
+#endif // ATTENDANCE_H
@@ -0,0 +1,43 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Compressed bitmap of 32-bit values, laid out like a roaring bitmap.
+//
+// Values are grouped by their high 16 bits into containers. A sparse
+// container is a sorted array of low 16-bit values; once it holds more than
+// BITMAP_ARRAY_MAX values it becomes a 65536-bit bitset. Intersections work
+// container by container, so cost follows the size of the smaller input.
+
+#define BITMAP_ARRAY_MAX 4096
+
+typedef struct {
+    uint16_t key;          // High 16 bits shared by all values
+    bool is_bitset;
+    uint32_t cardinality;
+    uint32_t capacity;     // Allocated array slots (array containers only)
+    void *data;            // uint16_t[capacity] or uint64_t[1024]
+} BitmapContainer;
+
+typedef struct {
+    BitmapContainer *containers;  // Sorted by key
+    uint32_t count;
+    uint32_t capacity;
+} Bitmap;
+
+void bitmap_init(Bitmap *bm);
+void bitmap_free(Bitmap *bm);
+bool bitmap_add(Bitmap *bm, uint32_t value);
+bool bitmap_remove(Bitmap *bm, uint32_t value);
+bool bitmap_contains(const Bitmap *bm, uint32_t value);
+uint32_t bitmap_cardinality(const Bitmap *bm);
+bool bitmap_and(const Bitmap *a, const Bitmap *b, Bitmap *out);
+bool bitmap_copy(const Bitmap *src, Bitmap *dst);
+uint32_t bitmap_to_array(const Bitmap *bm, uint32_t *out);
+bool bitmap_write(const Bitmap *bm, FILE *fp);
+bool bitmap_read(Bitmap *bm, FILE *fp);
+
+#endif // BITMAP_H
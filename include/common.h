@@ -47,8 +47,22 @@
 #define CONFIG_FILE "data/config.dat"
 #define USER_FILE "data/users.dat"
 #define STUDENT_FILE "data/students.dat"
+#define STUDENT_HOT_FILE "data/students.hot"
+#define STUDENT_WAL_FILE "data/students.wal"
+#define STUDENT_INDEX_FILE "data/students.idx"
+#define STUDENT_NAME_INDEX_FILE "data/students.names"
+#define STUDENT_FILTER_INDEX_FILE "data/students.filters"
+#define STUDENT_TEXT_INDEX_FILE "data/students.trigrams"
+#define ATTENDANCE_FILE "data/attendance.dat"
 #define EXAM_FILE "data/exam.dat"
+#define EXAM_DATA_FILE "data/papers.dat"
+#define EXAM_CATALOG_FILE "data/papers.cat"
+#define EXAM_LEGACY_FILE "data/exams.dat"
+#define QUESTION_BANK_FILE "data/questions.dat"
+#define EXAM_SCHEDULE_FILE "data/exam_schedule.dat"
+#define ANSWER_JOURNAL_FILE "data/answers.jnl"
 #define LOG_FILE "data/system.log"
+#define ID_CARD_DIR "cards"
 
 // Log levels
 #define LOG_DEBUG 0
@@ -83,8 +97,27 @@ struct SystemConfig {
     char contact_email[100];
     char contact_phone[20];
     time_t setup_date;
+    // Compaction policy. Appended fields read as zero from older config
+    // files, which means "drop every inactive record, however recent".
+    bool keep_inactive_students;
+    bool keep_deleted_papers;
+    int compact_min_age_days;   // Keep students deactivated more recently
+    int student_cache_kb;       // Lookup cache budget; 0 keeps the default
+    int negative_marking_percent;  // Of a question's marks lost per wrong answer;
+                                   // 0 keeps the default, negative turns it off
+    int answer_sync_ms;         // Answer journal sync interval; 0 keeps the default
+    int wal_commit_window_us;   // Student journal group commit wait; 0 keeps the
+                                // default, negative turns it off
 };
 
+// Outcome of rewriting a data file without its dead records
+typedef struct {
+    long records_before;
+    long records_after;
+    long long bytes_before;
+    long long bytes_after;
+} CompactionStats;
+
 // User structure
 struct User {
     int ID;
@@ -139,6 +172,7 @@ void show_documentation();
 void admin_panel();
 void user_panel();
 FILE* safe_open(const char *filename, const char *mode);
+bool replace_file(const char *tmp_path, const char *path);
 bool authenticate_user(const char *username, const char *password, User *user);
 SystemConfig load_system_config();
 void save_system_config(SystemConfig config);
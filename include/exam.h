@@ -2,7 +2,9 @@
 #define ENTRANCE_MANAGEMENT_SYSTEM_EXAM_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
+#include "common.h"
 
 #define MAX_TITLE_LENGTH 100
 #define MAX_SUBJECT_LENGTH 50
@@ -10,6 +12,9 @@
 #define MAX_OPTION_LENGTH 100
 #define MAX_QUESTIONS_PER_PAPER 100
 
+typedef struct ExamScore ExamScore;  // See scoring.h
+typedef struct AnswerKey AnswerKey;
+
 typedef struct Option {
     char text[MAX_OPTION_LENGTH];
     bool is_correct;
@@ -35,19 +40,40 @@ typedef struct {
     Question questions[MAX_QUESTIONS_PER_PAPER];
 } ExamPaper;
 
+// A paper as stored in EXAM_DATA_FILE: its fixed fields and the IDs of its
+// questions, which live in the question bank
+typedef struct {
+    int32_t paper_id;
+    char title[MAX_TITLE_LENGTH];
+    char subject[MAX_SUBJECT_LENGTH];
+    int32_t num_questions;
+    int32_t total_marks;
+    int32_t duration_minutes;
+    int64_t exam_date;
+    uint8_t is_active;
+    int32_t question_ids[MAX_QUESTIONS_PER_PAPER];
+} PaperRecord;
+
 // Core functions for exam paper management
 bool initialize_exam_system(void);
 ExamPaper* create_new_paper(const char* title, const char* subject, int duration);
 bool save_exam_paper(const ExamPaper* paper);
 bool load_exam_paper(int paper_id, ExamPaper* paper);
 bool add_question_to_paper(ExamPaper* paper, const Question* question);
+bool replace_question_in_paper(ExamPaper* paper, int index, const Question* question);
+bool remove_question_from_paper(ExamPaper* paper, int index);
+bool update_paper_details(ExamPaper* paper, const char* title, const char* subject, int duration);
 bool delete_exam_paper(int paper_id);
 bool assign_paper_to_date(int paper_id, time_t exam_date);
 ExamPaper* get_paper_for_date(time_t date);
 bool list_available_papers(void);
+bool list_scheduled_papers(time_t from, int days);
+bool compact_exam_papers(CompactionStats* stats);
 
 // Student exam functions
-bool start_exam(int student_id, ExamPaper* paper);
-bool submit_exam(int student_id, const ExamPaper* paper, int* answers);
+bool start_exam(int student_id, const ExamPaper* paper);
+bool submit_exam(int student_id, const ExamPaper* paper, int* answers, ExamScore* score);
+bool submit_exam_with_key(int student_id, const ExamPaper* paper, const AnswerKey* key,
+                          int* answers, ExamScore* score);
 
 #endif // ENTRANCE_MANAGEMENT_SYSTEM_EXAM_H
@@ -0,0 +1,35 @@
+#ifndef EXAM_CATALOG_H
+#define EXAM_CATALOG_H
+
+#include "common.h"
+#include "exam.h"
+#include <stdint.h>
+
+// Compact catalog of exam papers, kept in EXAM_CATALOG_FILE.
+//
+// Entry i summarizes the paper at record i of EXAM_DATA_FILE and holds the
+// record's offset, so listing, ID allocation and lookups by ID or date read
+// a couple of hundred bytes per paper instead of the full record with its
+// question IDs. An entry is written right after its record, under the
+// same byte-range lock. A catalog whose entry count disagrees with the data
+// file (missing, or short after a crash) is rebuilt from the fixed fields
+// at the front of each record.
+
+typedef struct {
+    int32_t paper_id;
+    char title[MAX_TITLE_LENGTH];
+    char subject[MAX_SUBJECT_LENGTH];
+    int32_t num_questions;
+    int32_t total_marks;
+    int32_t duration_minutes;
+    uint8_t is_active;
+    int64_t exam_date;
+    int64_t offset;      // Of the full record in EXAM_DATA_FILE
+} PaperSummary;
+
+PaperSummary* exam_catalog_load(int data_fd, int *count);
+PaperSummary* exam_catalog_read(int *count);
+bool exam_catalog_put(long recno, const PaperRecord *paper);
+void exam_catalog_remove(void);
+
+#endif // EXAM_CATALOG_H
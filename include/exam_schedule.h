@@ -0,0 +1,30 @@
+#ifndef EXAM_SCHEDULE_H
+#define EXAM_SCHEDULE_H
+
+#include "common.h"
+#include "exam.h"
+#include "exam_catalog.h"
+#include <stdint.h>
+
+// Calendar index of exam papers, kept in EXAM_SCHEDULE_FILE.
+//
+// One entry per active, dated paper, sorted by local calendar day, so the
+// paper for a day or the papers in a range of days are found by binary
+// search instead of converting every paper's date. Entries hold the
+// record's offset, like the catalog's. The file is small and is replaced
+// whole under its own lock, right after the record it describes. It
+// remembers how many data records it covers; one that disagrees with the
+// data file is rebuilt from the catalog.
+
+typedef struct {
+    int32_t day;         // From exam_schedule_day()
+    int32_t paper_id;
+    int64_t offset;      // Of the record in EXAM_DATA_FILE
+} ScheduleEntry;
+
+int32_t exam_schedule_day(time_t when);
+ScheduleEntry* exam_schedule_load(int data_fd, int32_t first_day, int32_t last_day, int *count);
+bool exam_schedule_put(long recno, const PaperRecord *paper);
+void exam_schedule_remove(void);
+
+#endif // EXAM_SCHEDULE_H
@@ -0,0 +1,41 @@
+#ifndef EXAM_SERVER_H
+#define EXAM_SERVER_H
+
+#include "common.h"
+
+// Exam session server for a centre's candidate terminals.
+//
+// One thread runs an epoll loop over a Unix-domain socket (an address with
+// a '/') or a TCP port on 127.0.0.1, speaking one request line and one
+// reply line at a time:
+//
+//   START <student_id> <paper_id>   OK <session> <questions> <minutes> <seconds left>
+//   QUESTION <n>                    QUESTION <n> <marks> <text>\t<A>\t<B>\t<C>\t<D>
+//   ANSWER <n> <A-D or ->           OK
+//   SUBMIT                          SCORE <score> <right> <wrong> <skipped>
+//   QUIT                            BYE
+//
+// with ERR <reason> for anything refused; a new session is only started
+// for an active student on the roll. Questions are numbered from 1 in
+// the candidate's shuffled order and options are lettered as shown
+// (exam_shuffle.h). Each paper is loaded, and its key compiled, once and
+// shared read-only by all its sessions; a session holds only the
+// candidate's order and answers and outlives its connection, so a terminal
+// that reconnects and sends START again carries on where it left off.
+// Sessions live in memory and every change to one is journaled
+// (answer_journal.h): a reply to START, ANSWER or SUBMIT is only sent once
+// the change is on disk, a failed sync is answered ERR could not save and
+// the connection closed, and a restarted server rebuilds its sessions from
+// the journal.
+//
+// A timed paper's duration runs from the session's start, whether or not
+// a terminal is connected. The terminal sitting the exam is sent TIME
+// <seconds left> between replies at each warning point, and TIME 0 when
+// time runs out and the answers are submitted as they stand; its next
+// request is refused with ERR time is up. Seconds left is -1 for an
+// untimed paper. Candidates are not authenticated: serve on an address
+// only the centre's terminals reach.
+
+bool run_exam_server(const char *address);
+
+#endif // EXAM_SERVER_H
@@ -0,0 +1,30 @@
+#ifndef EXAM_SHUFFLE_H
+#define EXAM_SHUFFLE_H
+
+#include "common.h"
+#include "exam.h"
+#include <stdint.h>
+
+// Per-candidate question and option order.
+//
+// Each candidate sees the paper's questions, and each question's options,
+// in an order drawn by Fisher-Yates from a xoshiro256** generator seeded
+// with (paper_id, student_id). Nothing is stored: the same pair always
+// gives the same order, so a candidate's view can be rebuilt at any time
+// and their answers mapped back to paper order for scoring. Changing the
+// generator or the seeding changes every candidate's order, including
+// those of exams in progress.
+
+#define SHUFFLE_OPTIONS 4
+
+typedef struct {
+    int num_questions;
+    uint8_t question_order[MAX_QUESTIONS_PER_PAPER];        // Position i shows this paper question
+    uint8_t option_order[MAX_QUESTIONS_PER_PAPER][SHUFFLE_OPTIONS];  // Per paper question, slot j shows this option
+} ExamShuffle;
+
+void exam_shuffle_derive(int paper_id, int student_id, int num_questions, ExamShuffle *shuffle);
+void exam_shuffle_view(const ExamPaper *paper, const ExamShuffle *shuffle, ExamPaper *view);
+void exam_shuffle_answers_to_paper(const ExamShuffle *shuffle, const int *shown, int *answers);
+
+#endif // EXAM_SHUFFLE_H
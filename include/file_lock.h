@@ -0,0 +1,32 @@
+#ifndef FILE_LOCK_H
+#define FILE_LOCK_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Advisory byte-range locks shared by every process using the data directory.
+//
+// Open file description (OFD) locks are used where the kernel has them. They
+// belong to the open file rather than the process, so a lock is only dropped
+// by closing the descriptor that took it, and two descriptors contend even
+// within one process. Elsewhere classic POSIX record locks are used instead.
+//
+// Stores of fixed-size records lock the byte range of a record to write it
+// and take shared locks to scan. Appending a record also locks
+// FILE_LOCK_APPEND_BYTE, a byte far past any real data, which serializes
+// ID allocation without blocking readers of existing records.
+
+#define FILE_LOCK_APPEND_BYTE ((off_t)1 << 40)
+#define FILE_LOCK_RECORDS FILE_LOCK_APPEND_BYTE  // Length covering every record
+#define FILE_LOCK_WHOLE 0                        // Length to end of file and beyond
+
+typedef enum {
+    FILE_LOCK_SHARED,
+    FILE_LOCK_EXCLUSIVE
+} FileLockMode;
+
+bool file_lock(int fd, off_t start, off_t len, FileLockMode mode);
+bool file_unlock(int fd, off_t start, off_t len);
+bool file_is_current(int fd, const char *path);
+
+#endif // FILE_LOCK_H
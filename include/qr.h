@@ -0,0 +1,30 @@
+#ifndef QR_H
+#define QR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// QR Code encoder (ISO/IEC 18004), byte mode at error correction level M.
+//
+// Versions 1 to 10 are supported, which holds up to 213 bytes of payload
+// and comfortably covers MAX_QR_DATA. The smallest version that fits is
+// chosen, data is protected with Reed-Solomon codes over GF(256) and the
+// mask with the lowest penalty score is applied.
+
+#define QR_MAX_VERSION 10
+#define QR_MAX_SIZE (17 + 4 * QR_MAX_VERSION)
+#define QR_QUIET_ZONE 4
+
+typedef struct {
+    int version;
+    int size;                                  // Modules per side
+    uint8_t modules[QR_MAX_SIZE][QR_MAX_SIZE]; // [row][col], 1 is dark
+} QrCode;
+
+bool qr_encode(const char *text, QrCode *qr);
+bool qr_write_svg(const QrCode *qr, FILE *fp);
+bool qr_write_pbm(const QrCode *qr, FILE *fp);
+int qr_svg_path(const QrCode *qr, char *out, size_t size);
+
+#endif // QR_H
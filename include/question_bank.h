@@ -0,0 +1,25 @@
+#ifndef QUESTION_BANK_H
+#define QUESTION_BANK_H
+
+#include "common.h"
+#include "exam.h"
+
+// Shared store of exam questions, kept in QUESTION_BANK_FILE.
+//
+// Questions are stored once, as variable-length records carrying only the
+// bytes actually used, and papers refer to them by question_id. Records are
+// appended and never rewritten: interning a question whose content is
+// already in the bank returns the existing ID, so papers sharing a question
+// share its record, and editing a question in one paper yields a new ID
+// rather than changing the others. Each record holds a 64-bit hash of its
+// payload, which both finds duplicates and detects a torn tail after a
+// crash.
+//
+// IDs are handed out in file order under the bank's append lock. Readers
+// take no locks; they index whatever complete records are on disk.
+
+int question_bank_intern(const Question *question);
+bool question_bank_load(int question_id, Question *question);
+int question_bank_count(void);
+
+#endif // QUESTION_BANK_H
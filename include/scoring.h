@@ -0,0 +1,51 @@
+#ifndef SCORING_H
+#define SCORING_H
+
+#include "common.h"
+#include "exam.h"
+#include <stdint.h>
+
+// Batch scoring of answer sheets against a compiled answer key.
+//
+// Each question takes one 4-bit nibble, bit i standing for option i, so a
+// 64-bit word holds 16 questions. The key holds the correct options; a
+// sheet holds the options the candidate chose, none for unanswered. An
+// answer is right when its nibble equals the key's and wrong when it is
+// set but differs. Marks are split into bit-planes, so a word is scored
+// with a few masks and popcounts rather than question by question. Wrong
+// answers lose negative_fraction of the question's marks.
+
+#define SCORING_WORDS ((MAX_QUESTIONS_PER_PAPER + 15) / 16)
+#define SCORING_MARK_BITS 8                  // Marks per question up to 255
+#define SCORING_DEFAULT_NEGATIVE_PERCENT 10  // As in the original exam
+
+typedef struct AnswerKey {
+    int paper_id;
+    int num_questions;
+    int words;
+    int mark_bits;                           // Planes in use
+    double negative_fraction;
+    uint64_t key[SCORING_WORDS];             // Correct options
+    uint64_t present[SCORING_WORDS];         // Low bit of each question's nibble
+    uint64_t planes[SCORING_MARK_BITS][SCORING_WORDS];  // Bit b of each question's marks
+} AnswerKey;
+
+typedef struct {
+    uint64_t words[SCORING_WORDS];           // Chosen options
+} AnswerSheet;
+
+typedef struct ExamScore {
+    double score;
+    int32_t marks_right;
+    int32_t marks_wrong;
+    int16_t right;
+    int16_t wrong;
+    int16_t unanswered;
+} ExamScore;
+
+double scoring_negative_fraction(void);
+bool scoring_compile_key(const ExamPaper *paper, double negative_fraction, AnswerKey *key);
+void scoring_pack_answers(const int *answers, int count, AnswerSheet *sheet);
+void scoring_score_batch(const AnswerKey *key, const AnswerSheet *sheets, size_t count, ExamScore *scores);
+
+#endif // SCORING_H
@@ -32,15 +32,31 @@ struct Student {
     int created_by; // User ID who created this student
 };
 
+// Scan-hot subset of a Student, stored densely in STUDENT_HOT_FILE at the
+// same record number as the full record in STUDENT_FILE. Listing and index
+// rebuilds read these instead of the full ~1 KB records.
+typedef struct StudentSummary {
+    int id;
+    char name[MAX_NAME];
+    char grade[10];
+    char section[10];
+    bool is_active;
+} StudentSummary;
+
+#define STUDENT_SEARCH_LIMIT 20
+
 // Function prototypes
 // Student management
+// Lookups return pointers into the memory-mapped student file. They must not
+// be freed or modified and stay valid until the next write to the store.
 bool add_student(Student *student);
 bool update_student(Student *student);
 bool delete_student(int student_id);
-Student* get_student(int student_id);
-Student* get_student_by_username(const char *username);
-Student* get_students(int *count);
-Student* search_students(const char *query, int *count);
+const Student* get_student(int student_id);
+const Student* get_student_by_username(const char *username);
+const Student* get_students(int *count);
+const StudentSummary* get_student_summaries(int *count);
+const Student** search_students(const char *query, int *count);
 
 // Student exam related
 bool register_student_for_exam(int student_id, int exam_id);
@@ -56,29 +72,46 @@ bool save_students(const Student *students, int count);
 bool load_students(Student **students, int *count);
 
 // Search and filters
-Student* filter_students_by_grade(const char *grade, int *count);
-Student* filter_students_by_section(const char *section, int *count);
-Student* filter_students_by_status(bool is_active, int *count);
+// search_students lists names starting with query (case-insensitive), then
+// up to STUDENT_SEARCH_LIMIT fuzzy matches ranked by trigram similarity
+// across name, email, school and parent name. filter_students
+// combines grade, section and status (1 active, 0 inactive, -1 any). These
+// return a malloc'd array of pointers into the mapping; free the
+// array only.
+const Student** filter_students(const char *grade, const char *section, int status, int *count);
+const Student** filter_students_by_grade(const char *grade, int *count);
+const Student** filter_students_by_section(const char *section, int *count);
+const Student** filter_students_by_status(bool is_active, int *count);
 
 // Statistics
 int get_total_students(void);
 int get_active_students_count(void);
 int get_inactive_students_count(void);
+int get_grade_student_count(const char *grade, bool active_only);
+
+// Maintenance
+bool compact_students(int min_age_days, CompactionStats *stats);
 
 // User interface
 void show_student_menu(void);
 void show_student_details(const Student *student);
 void show_student_list(const Student *students, int count);
+void list_students(void);
 void show_student_exam_results(int student_id);
 
 // QR Code functions
 bool generate_qr_code(const char *data, const char *filename);
 bool verify_qr_code(const char *filename, const char *expected_data);
-void generate_student_id_card(const Student *student);
+bool check_in_with_qr(const char *qr_data);
+const Student* resolve_qr_payload(const char *qr_data);
+bool generate_student_id_card(const Student *student);
+int generate_id_cards(const char *grade);
+int format_qr_payload(const Student *student, char *out, size_t size);
 
 // Import/Export
 bool import_students_from_csv(const char *filename);
 bool export_students_to_csv(const char *filename);
+bool export_students_csv(const char *filename, const char *columns, const char *grade, int status);
 bool export_student_list_as_pdf(const char *filename);
 void generate_student_report(int student_id);
 void generate_class_report(void);
@@ -0,0 +1,36 @@
+#ifndef STUDENT_CACHE_H
+#define STUDENT_CACHE_H
+
+#include "common.h"
+#include "student.h"
+
+// Cache in front of get_student() and get_student_by_username().
+//
+// Records already live in the shared mapping of the student file, so the
+// cache keeps where a student is rather than a copy: each entry maps an ID
+// and a username to a record number. A hit is checked against the mapped
+// record itself and costs no system calls; only misses fall through to the
+// ID index or the username scan. Updates rewrite records in place, so a
+// hit always sees the latest contents, and entries are dropped when the
+// mapped file changes (see student_store_epoch()). Entries are evicted by
+// CLOCK once the memory budget is used up.
+
+#define STUDENT_CACHE_DEFAULT_BUDGET (64 * 1024)  // Bytes, about 1600 students
+
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    size_t entries;
+    size_t capacity;
+} StudentCacheStats;
+
+void student_cache_set_budget(size_t bytes);
+const Student* student_cache_get(int student_id);
+const Student* student_cache_get_by_username(const char *username);
+void student_cache_put(long recno, const Student *student);
+void student_cache_forget(int student_id);
+void student_cache_clear(void);
+void student_cache_stats(StudentCacheStats *stats);
+
+#endif // STUDENT_CACHE_H
@@ -0,0 +1,23 @@
+#ifndef STUDENT_FILTER_INDEX_H
+#define STUDENT_FILTER_INDEX_H
+
+#include "common.h"
+#include "student.h"
+
+// Bitmap indexes over Student.grade, Student.section and Student.is_active.
+//
+// Each distinct grade and section value owns a compressed bitmap of record
+// numbers, and active/inactive records each have one more. A combined
+// filter is answered by intersecting the relevant bitmaps, smallest first,
+// so only matching records are ever touched. Like the name index, the
+// bitmaps live in memory and are saved to STUDENT_FILTER_INDEX_FILE on exit.
+
+#define FILTER_ANY_STATUS (-1)
+
+bool student_filter_index_open(void);
+bool student_filter_index_save(void);
+void student_filter_index_invalidate(void);
+void student_filter_index_update(long recno, const Student *old, const Student *updated);
+long* student_filter_index_query(const char *grade, const char *section, int status, int *count);
+
+#endif // STUDENT_FILTER_INDEX_H
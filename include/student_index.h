@@ -0,0 +1,21 @@
+#ifndef STUDENT_INDEX_H
+#define STUDENT_INDEX_H
+
+#include "common.h"
+
+// Persistent primary-key index for STUDENT_FILE.
+//
+// The index is an open-addressing hash table stored in STUDENT_INDEX_FILE,
+// mapping a student ID to its record number in the student file. Slots are
+// read and written individually, so a lookup or insert touches a handful of
+// bytes on disk instead of scanning every Student record. The data file is
+// always the source of truth: if the index is missing or covers a different
+// number of records, it is rebuilt from the data file on open.
+
+bool student_index_open(void);
+void student_index_close(void);
+bool student_index_lookup(int student_id, long *recno);
+bool student_index_insert(int student_id, long recno);
+bool student_index_rebuild(void);
+
+#endif // STUDENT_INDEX_H
@@ -0,0 +1,22 @@
+#ifndef STUDENT_NAME_INDEX_H
+#define STUDENT_NAME_INDEX_H
+
+#include "common.h"
+
+// Case-insensitive name index over STUDENT_FILE.
+//
+// Names are case-folded and whitespace-normalized, then kept in a sorted
+// array of (name, record number) pairs, so exact and prefix lookups cost a
+// binary search plus one step per match. The array is held in memory and
+// saved to STUDENT_NAME_INDEX_FILE on exit together with a stamp of the
+// student file; a stale or missing snapshot is rebuilt from the store.
+
+bool student_name_index_open(void);
+bool student_name_index_save(void);
+void student_name_index_invalidate(void);
+void student_name_index_insert(const char *name, long recno);
+void student_name_index_remove(const char *name, long recno);
+long* student_name_index_search(const char *query, bool prefix, int *count);
+void student_name_index_fold(const char *name, char *out, size_t size);
+
+#endif // STUDENT_NAME_INDEX_H
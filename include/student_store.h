@@ -0,0 +1,80 @@
+#ifndef STUDENT_STORE_H
+#define STUDENT_STORE_H
+
+#include "common.h"
+#include "student.h"
+#include <stdint.h>
+
+// Memory-mapped, read-only view of STUDENT_FILE and STUDENT_HOT_FILE.
+//
+// Records are exposed in place as const Student pointers, so scans and
+// lookups cost no per-record copies or syscalls. Scans that only need the
+// hot fields should use student_store_summary(), which reads the dense
+// summary table and leaves the full records out of the page cache. The mapping reserves room
+// beyond the end of the file and is only remapped when the file outgrows it
+// or is replaced, which is checked once per student_store_refresh() call.
+// Pointers stay valid until the next refresh that remaps, so callers must
+// not hold them across writes to the student file.
+//
+// Readers take no locks. Writers, in this process or any other sharing the
+// data directory, hold student_store_lock() from reading the header until
+// the record and the new header are applied.
+
+// The first STUDENT_HEADER_SIZE bytes of STUDENT_FILE hold a versioned
+// header with running totals, so counts and ID allocation never scan.
+// Every mutation writes the record and the updated header together, and
+// the journal carries the header image alongside the record. A header
+// whose record count disagrees with the file (a crash during a bulk
+// append) is recomputed on open; files without a header are migrated.
+#define STUDENT_STORE_MAGIC 0x4f545353u  // "SSTO"
+#define STUDENT_STORE_RETIRED 0x44525453u // "STRD", a file compaction replaced
+#define STUDENT_STORE_VERSION 1
+#define STUDENT_HEADER_SIZE 4096
+#define STUDENT_GRADE_SLOTS 32
+
+typedef struct {
+    char grade[10];
+    int32_t total;
+    int32_t active;
+} GradeCount;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation;        // Bumped by every change to the file
+    int64_t record_count;
+    int64_t active_count;
+    int32_t next_id;            // Lowest ID above every ID ever stored
+    int32_t grade_count;        // Slots of grades[] in use
+    int32_t grades_overflow;    // Non-zero if some grade found no slot
+    GradeCount grades[STUDENT_GRADE_SLOTS];
+} StudentStoreHeader;
+
+// Identifies a version of the student file, so derived index files can
+// tell whether they are still current
+typedef struct {
+    long long size;
+    long long generation;
+} StudentStoreStamp;
+
+bool student_store_open(void);
+void student_store_close(void);
+bool student_store_refresh(void);
+size_t student_store_count(void);
+const Student* student_store_at(size_t recno);
+const StudentSummary* student_store_summary(size_t recno);
+bool student_store_write_summary(long recno, const Student *student);
+const StudentStoreHeader* student_store_header(void);
+bool student_store_next_header(long recno, const Student *student, StudentStoreHeader *out);
+bool student_store_apply(long recno, const Student *student, const StudentStoreHeader *header);
+bool student_store_rebuild_header(void);
+bool student_store_sync(void);
+bool student_store_lock(void);
+void student_store_unlock(void);
+bool student_store_compact(bool (*keep)(const Student *student, void *ctx), void *ctx,
+                           CompactionStats *stats);
+unsigned student_store_epoch(void);
+StudentStoreStamp student_store_stamp(void);
+bool student_store_stamp_equal(StudentStoreStamp a, StudentStoreStamp b);
+
+#endif // STUDENT_STORE_H
@@ -0,0 +1,30 @@
+#ifndef STUDENT_TEXT_INDEX_H
+#define STUDENT_TEXT_INDEX_H
+
+#include "common.h"
+#include "student.h"
+
+// Trigram index over Student.name, email, school and parent_name.
+//
+// Text is case-folded and split into words at anything that is not a
+// letter or digit; each word, padded with two spaces in front and one
+// behind, contributes its three-character substrings. Every trigram owns a
+// compressed bitmap of the record numbers containing it. A search counts
+// shared trigrams per record from the postings of the query's trigrams,
+// then scores the best candidates field by field. Like the other secondary
+// indexes it lives in memory and is saved to STUDENT_TEXT_INDEX_FILE on exit.
+
+#define TEXT_MATCH_THRESHOLD 0.3  // Minimum share of query trigrams matched
+
+typedef struct {
+    long recno;
+    double score;       // Share of query trigrams found in the best field
+} TextMatch;
+
+bool student_text_index_open(void);
+bool student_text_index_save(void);
+void student_text_index_invalidate(void);
+void student_text_index_update(long recno, const Student *old, const Student *updated);
+TextMatch* student_text_index_search(const char *query, int limit, int *count);
+
+#endif // STUDENT_TEXT_INDEX_H
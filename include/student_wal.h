@@ -0,0 +1,38 @@
+#ifndef STUDENT_WAL_H
+#define STUDENT_WAL_H
+
+#include "common.h"
+#include "student.h"
+#include "student_store.h"
+#include <stdint.h>
+
+// Write-ahead journal for mutations of STUDENT_FILE.
+//
+// Every add, update and delete appends the after-image of the record and of
+// the student file header to STUDENT_WAL_FILE before the student file is
+// touched, and is acknowledged only once its journal record is on disk.
+// Commits are grouped: the first writer to need an fsync becomes the
+// leader, optionally waits up to the commit window for other writers to
+// join, and one fdatasync covers them all. Only threads of one process are
+// grouped: terminals running as separate processes each fdatasync their own
+// commits. The window is set from SystemConfig.wal_commit_window_us. The
+// student file itself is only forced at checkpoints, after which the
+// journal is truncated. Recovery replays the journal's intact prefix.
+
+#define WAL_OP_INSERT 1
+#define WAL_OP_UPDATE 2
+#define WAL_OP_DELETE 3
+
+#define WAL_DEFAULT_COMMIT_WINDOW_US 2000
+#define WAL_CHECKPOINT_BYTES (4L * 1024 * 1024)
+
+bool student_wal_open(void);
+bool student_wal_recover(void);
+uint64_t student_wal_append(int op, long recno, const Student *image,
+                            const StudentStoreHeader *header);
+bool student_wal_commit(uint64_t lsn);
+bool student_wal_checkpoint(void);
+bool student_wal_needs_checkpoint(void);
+void student_wal_set_commit_window(unsigned usec);
+
+#endif // STUDENT_WAL_H
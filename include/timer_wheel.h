@@ -0,0 +1,46 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hierarchical timing wheel.
+//
+// Timers are counted in ticks of the caller's choosing. Level 0 has a slot
+// for each of the next 64 ticks, level 1 a slot for each of the next 64
+// spans of 64 ticks, and so on up four levels. Adding a timer puts it in
+// the slot for its expiry and cancelling unlinks it, both in constant
+// time; when level 0 comes round, the next slot up is spread back down.
+// Timers further out than the top level reaches wait in its last slot and
+// are placed again as it comes round. Entries are embedded in the caller's
+// own structures, so the wheel never allocates.
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+
+typedef struct TimerEntry {
+    struct TimerEntry *next;
+    struct TimerEntry **pprev;    // Link pointing here; NULL when not pending
+    uint64_t expires;             // Tick
+    void (*fire)(struct TimerEntry *timer, void *arg);
+} TimerEntry;
+
+typedef struct {
+    uint64_t now;                 // Last tick processed
+    size_t pending;
+    TimerEntry *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TimerWheel;
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now);
+void timer_init(TimerEntry *timer, void (*fire)(TimerEntry *timer, void *arg));
+void timer_wheel_add(TimerWheel *wheel, TimerEntry *timer, uint64_t expires);
+void timer_wheel_cancel(TimerWheel *wheel, TimerEntry *timer);
+size_t timer_wheel_advance(TimerWheel *wheel, uint64_t now, void *arg);
+
+static inline bool timer_pending(const TimerEntry *timer) {
+    return timer->pprev != NULL;
+}
+
+#endif // TIMER_WHEEL_H
@@ -11,6 +11,6 @@ void view_logs(void);
 void change_password(void);
 
 // User-related functions
-// ...existing code...
+bool record_user_login(const char *username);
 
 #endif // USER_H
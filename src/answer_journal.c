@@ -0,0 +1,168 @@
+#include "../include/answer_journal.h"
+#include "../include/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#define ANSWER_JOURNAL_BATCH 4096  // Events buffered between writes
+
+static int journal_fd = -1;
+static AnswerEvent pending[ANSWER_JOURNAL_BATCH];
+static int pending_count = 0;
+static bool unsynced = false;        // Events written or buffered since the last sync
+static bool failed = false;          // A sync failed; nothing more can be trusted to disk
+static off_t journal_size = 0;       // Bytes of whole events written
+static int64_t oldest_unsynced_ms = 0;
+static int sync_interval_ms = ANSWER_JOURNAL_DEFAULT_SYNC_MS;
+
+static uint32_t event_check(const AnswerEvent *event) {
+    const uint8_t *p = (const uint8_t*)event;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(AnswerEvent, check); i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void answer_journal_set_sync_interval(int ms) {
+    sync_interval_ms = ms > 0 ? ms : ANSWER_JOURNAL_DEFAULT_SYNC_MS;
+}
+
+// Replay the journal's intact events through apply, then keep it open for
+// appending. apply returns false for an event that no longer fits (its
+// paper is gone, say); such events are skipped. Only one process may have
+// the journal open.
+bool answer_journal_open(bool (*apply)(const AnswerEvent *event, void *arg), void *arg) {
+    if (journal_fd >= 0) return true;
+
+    int fd = open(ANSWER_JOURNAL_FILE, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log_message(LOG_ERROR, "Failed to open answer journal");
+        return false;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        log_message(LOG_ERROR, "Answer journal is in use by another exam server");
+        close(fd);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    size_t replayed = 0, skipped = 0;
+    off_t intact = 0;
+    bool torn = false;
+    ssize_t n;
+    while (!torn && (n = pread(fd, pending, sizeof(pending), intact)) > 0) {
+        size_t count = (size_t)n / sizeof(AnswerEvent);
+        for (size_t i = 0; i < count; i++) {
+            if (pending[i].check != event_check(&pending[i])) {
+                torn = true;
+                break;
+            }
+            if (apply(&pending[i], arg)) replayed++;
+            else skipped++;
+            intact += sizeof(AnswerEvent);
+        }
+        if ((size_t)n % sizeof(AnswerEvent) != 0) torn = true;
+    }
+
+    // Whatever follows the last intact event was being written at a crash
+    if (intact < st.st_size) {
+        if (ftruncate(fd, intact) != 0 || fdatasync(fd) != 0) {
+            log_message(LOG_ERROR, "Failed to cut the torn tail of the answer journal");
+            close(fd);
+            return false;
+        }
+        log_message(LOG_WARNING, "Cut %lld bytes of torn answer journal tail",
+                    (long long)(st.st_size - intact));
+    }
+    if (replayed > 0 || skipped > 0) {
+        log_message(LOG_INFO, "Replayed %zu answer journal events (%zu skipped)", replayed, skipped);
+    }
+
+    journal_fd = fd;
+    journal_size = intact;
+    pending_count = 0;
+    unsynced = false;
+    failed = false;
+    return true;
+}
+
+// Write the queued events. On failure they stay queued for the next try,
+// and any part of the batch that did land is cut off again so the retry
+// leaves no torn event inside the journal.
+static bool write_pending(void) {
+    if (pending_count == 0) return true;
+    size_t bytes = (size_t)pending_count * sizeof(AnswerEvent);
+    ssize_t n;
+    while ((n = write(journal_fd, pending, bytes)) < 0 && errno == EINTR) {}
+    if (n != (ssize_t)bytes) {
+        log_message(LOG_ERROR, "Failed to write answer journal");
+        if (n > 0 && ftruncate(journal_fd, journal_size) != 0) {
+            log_message(LOG_ERROR, "Failed to cut a partial write from the answer journal");
+            failed = true;
+        }
+        return false;
+    }
+    journal_size += (off_t)bytes;
+    pending_count = 0;
+    return true;
+}
+
+// Queue an event; it is durable once answer_journal_sync() next returns
+bool answer_journal_append(AnswerEvent *event) {
+    if (journal_fd < 0 || failed) return false;
+    if (pending_count == ANSWER_JOURNAL_BATCH && !write_pending()) return false;
+
+    event->reserved = 0;
+    event->check = event_check(event);
+    pending[pending_count++] = *event;
+    if (!unsynced) {
+        unsynced = true;
+        oldest_unsynced_ms = event->time_ms;
+    }
+    return true;
+}
+
+// Milliseconds until the queued events are due to be synced, -1 if there
+// are none
+int answer_journal_sync_wait(int64_t now_ms) {
+    if (!unsynced) return -1;
+    int64_t wait = oldest_unsynced_ms + sync_interval_ms - now_ms;
+    return wait > 0 ? (int)wait : 0;
+}
+
+// Write and sync the queued events. False means they are not known to be
+// on disk. A failed write is retried a sync interval later; a failed
+// fdatasync is final, since the kernel may already have dropped the pages
+// it could not write, and the journal accepts no more events.
+bool answer_journal_sync(void) {
+    if (journal_fd < 0 || !unsynced) return true;
+    if (failed) return false;
+    if (!write_pending()) {
+        oldest_unsynced_ms += sync_interval_ms;
+        return false;
+    }
+    if (fdatasync(journal_fd) != 0) {
+        log_message(LOG_ERROR, "Failed to sync answer journal; no further answers can be saved");
+        failed = true;
+        return false;
+    }
+    unsynced = false;
+    return true;
+}
+
+void answer_journal_close(void) {
+    if (journal_fd < 0) return;
+    answer_journal_sync();
+    close(journal_fd);
+    journal_fd = -1;
+}
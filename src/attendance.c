@@ -0,0 +1,246 @@
+#include "../include/attendance.h"
+#include "../include/student.h"
+#include "../include/bitmap.h"
+#include "../include/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define CHECKIN_LINE_MAX 256
+#define CHECKIN_READ_BUFFER 65536
+#define CHECKIN_EVENT_BATCH 512
+#define CHECKIN_TICK_MS 1000
+
+typedef struct {
+    int journal_fd;
+    AttendanceEvent pending[CHECKIN_EVENT_BATCH];
+    int pending_count;
+    Bitmap checked_in;       // Student IDs checked in today
+    int64_t day_end_ms;      // Local midnight when checked_in goes stale
+    size_t scans, admitted, duplicates, rejected;
+    size_t last_scans;       // scans at the previous report
+    int64_t last_report_ms;
+} CheckinSession;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Local midnight that began today, or days_ahead days after it
+static int64_t local_midnight_ms(int days_ahead) {
+    time_t now = time(NULL);
+    struct tm day = *localtime(&now);
+    day.tm_hour = day.tm_min = day.tm_sec = 0;
+    day.tm_mday += days_ahead;
+    day.tm_isdst = -1;
+    return (int64_t)mktime(&day) * 1000;
+}
+
+// Seed today's checked-in set from the journal, so a restarted station
+// still recognizes repeat scans
+static bool load_todays_checkins(CheckinSession *session) {
+    FILE *fp = fopen(ATTENDANCE_FILE, "rb");
+    if (!fp) return true;
+
+    int64_t since = local_midnight_ms(0);
+    AttendanceEvent events[CHECKIN_EVENT_BATCH];
+    size_t n;
+    bool ok = true;
+    while (ok && (n = fread(events, sizeof(AttendanceEvent), CHECKIN_EVENT_BATCH, fp)) > 0) {
+        for (size_t i = 0; ok && i < n; i++) {
+            if (events[i].time_ms >= since && !(events[i].flags & ATTENDANCE_DUPLICATE)) {
+                ok = bitmap_add(&session->checked_in, (uint32_t)events[i].student_id);
+            }
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+// Start the day's checked-in set afresh, seeded from the journal
+static bool start_checkin_day(CheckinSession *session) {
+    bitmap_free(&session->checked_in);
+    bitmap_init(&session->checked_in);
+    session->day_end_ms = local_midnight_ms(1);
+    return load_todays_checkins(session);
+}
+
+static bool flush_events(CheckinSession *session, bool sync) {
+    bool ok = true;
+    if (session->pending_count > 0) {
+        size_t bytes = (size_t)session->pending_count * sizeof(AttendanceEvent);
+        ok = write(session->journal_fd, session->pending, bytes) == (ssize_t)bytes;
+        session->pending_count = 0;
+    }
+    if (ok && sync) ok = fdatasync(session->journal_fd) == 0;
+    if (!ok) log_message(LOG_ERROR, "Failed to write attendance journal");
+    return ok;
+}
+
+static void record_scan(CheckinSession *session, const char *payload) {
+    session->scans++;
+    const Student *s = resolve_qr_payload(payload);
+    if (!s) {
+        session->rejected++;
+        return;
+    }
+
+    // Yesterday's check-ins no longer make a scan a repeat
+    int64_t now = now_ms();
+    if (now >= session->day_end_ms) {
+        if (!start_checkin_day(session)) {
+            log_message(LOG_ERROR, "Failed to reload today's check-ins");
+        }
+    }
+
+    AttendanceEvent *event = &session->pending[session->pending_count++];
+    event->time_ms = now;
+    event->student_id = s->id;
+    event->flags = 0;
+    if (bitmap_contains(&session->checked_in, (uint32_t)s->id)) {
+        event->flags = ATTENDANCE_DUPLICATE;
+        session->duplicates++;
+    } else {
+        bitmap_add(&session->checked_in, (uint32_t)s->id);
+        session->admitted++;
+    }
+
+    if (session->pending_count == CHECKIN_EVENT_BATCH) flush_events(session, false);
+}
+
+static void report(CheckinSession *session, int64_t now) {
+    double seconds = (double)(now - session->last_report_ms) / 1000.0;
+    double rate = seconds > 0 ? (double)(session->scans - session->last_scans) / seconds : 0;
+    printf("\n\t\t%zu scans (%.0f/s)  checked in %zu  duplicates %zu  rejected %zu",
+           session->scans, rate, session->admitted, session->duplicates, session->rejected);
+    fflush(stdout);
+    session->last_scans = session->scans;
+    session->last_report_ms = now;
+}
+
+// Split newly read bytes into payload lines; a partial line is kept in
+// line for the next read. Overlong lines are counted as rejects.
+static void process_input(CheckinSession *session, const char *data, size_t len,
+                          char *line, size_t *line_len, bool *overlong) {
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (c == '\n') {
+            if (*overlong) {
+                session->scans++;
+                session->rejected++;
+            } else {
+                if (*line_len > 0 && line[*line_len - 1] == '\r') (*line_len)--;
+                line[*line_len] = '\0';
+                if (*line_len > 0) record_scan(session, line);
+            }
+            *line_len = 0;
+            *overlong = false;
+        } else if (*line_len + 1 < CHECKIN_LINE_MAX) {
+            line[(*line_len)++] = c;
+        } else {
+            *overlong = true;
+        }
+    }
+}
+
+// Read payloads from path (stdin if NULL) until end of input or SIGINT. A
+// FIFO is opened for writing too, so it never reports end of input and
+// scanners can come and go while the station keeps running.
+bool run_checkin_stream(const char *path) {
+    CheckinSession *session = calloc(1, sizeof(CheckinSession));
+    char *buffer = malloc(CHECKIN_READ_BUFFER);
+    if (!session || !buffer) {
+        free(session);
+        free(buffer);
+        log_message(LOG_ERROR, "Memory allocation failed for check-in stream");
+        return false;
+    }
+    bitmap_init(&session->checked_in);
+
+    bool ok = start_checkin_day(session);
+    session->journal_fd = open(ATTENDANCE_FILE, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    struct stat st;
+    bool is_fifo = path && stat(path, &st) == 0 && S_ISFIFO(st.st_mode);
+    int in = path ? open(path, is_fifo ? O_RDWR : O_RDONLY) : STDIN_FILENO;
+    if (!ok || session->journal_fd < 0 || in < 0) {
+        log_message(LOG_ERROR, "Failed to start check-in stream%s%s", path ? " on " : "",
+                    path ? path : "");
+        ok = false;
+    }
+
+    // Let Ctrl-C end the session cleanly instead of losing buffered events
+    struct sigaction sa, old_sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = request_stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_sa);
+    stop_requested = 0;
+
+    char line[CHECKIN_LINE_MAX];
+    size_t line_len = 0;
+    bool overlong = false;
+    session->last_report_ms = now_ms();
+    if (ok) log_message(LOG_INFO, "Check-in stream started on %s", path ? path : "stdin");
+
+    while (ok && !stop_requested) {
+        struct pollfd pfd = { in, POLLIN, 0 };
+        int ready = poll(&pfd, 1, CHECKIN_TICK_MS);
+        if (ready < 0 && errno != EINTR) break;
+
+        if (ready > 0) {
+            ssize_t n = read(in, buffer, CHECKIN_READ_BUFFER);
+            if (n > 0) {
+                process_input(session, buffer, (size_t)n, line, &line_len, &overlong);
+            } else if (n == 0 || errno != EINTR) {
+                break;
+            }
+        } else if (ready == 0 && is_fifo && (line_len > 0 || overlong)) {
+            // A line left unfinished for a whole tick is from a scanner that
+            // went away; don't glue it onto the next scanner's payload
+            session->scans++;
+            session->rejected++;
+            line_len = 0;
+            overlong = false;
+        }
+
+        int64_t now = now_ms();
+        if (now - session->last_report_ms >= CHECKIN_TICK_MS) {
+            ok = flush_events(session, true);
+            if (session->scans != session->last_scans) report(session, now);
+            else session->last_report_ms = now;
+        }
+    }
+
+    // A final line without a newline still counts
+    if (line_len > 0 && !overlong) {
+        line[line_len] = '\0';
+        record_scan(session, line);
+    }
+    if (session->journal_fd >= 0) {
+        ok = flush_events(session, true) && ok;
+        close(session->journal_fd);
+    }
+    if (path && in >= 0) close(in);
+    sigaction(SIGINT, &old_sa, NULL);
+
+    report(session, now_ms());
+    log_message(LOG_INFO, "Check-in stream ended: %zu scans, %zu checked in, %zu duplicates, %zu rejected",
+                session->scans, session->admitted, session->duplicates, session->rejected);
+
+    bitmap_free(&session->checked_in);
+    free(session);
+    free(buffer);
+    return ok;
+}
@@ -0,0 +1,375 @@
+#include "../include/bitmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BITSET_WORDS 1024  // 65536 bits
+
+// Index of the container for key, or -(insert position) - 1 if absent
+static int32_t find_container(const Bitmap *bm, uint16_t key) {
+    int32_t lo = 0, hi = (int32_t)bm->count - 1;
+    while (lo <= hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        uint16_t k = bm->containers[mid].key;
+        if (k == key) return mid;
+        if (k < key) lo = mid + 1; else hi = mid - 1;
+    }
+    return -(lo + 1);
+}
+
+// Position of value in a sorted array, or -(insert position) - 1
+static int32_t array_search(const uint16_t *arr, uint32_t n, uint16_t value) {
+    int32_t lo = 0, hi = (int32_t)n - 1;
+    while (lo <= hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if (arr[mid] == value) return mid;
+        if (arr[mid] < value) lo = mid + 1; else hi = mid - 1;
+    }
+    return -(lo + 1);
+}
+
+static void container_free(BitmapContainer *c) {
+    free(c->data);
+    c->data = NULL;
+}
+
+static bool array_to_bitset(BitmapContainer *c) {
+    uint64_t *words = calloc(BITSET_WORDS, sizeof(uint64_t));
+    if (!words) return false;
+    const uint16_t *arr = c->data;
+    for (uint32_t i = 0; i < c->cardinality; i++) {
+        words[arr[i] >> 6] |= 1ULL << (arr[i] & 63);
+    }
+    free(c->data);
+    c->data = words;
+    c->is_bitset = true;
+    c->capacity = 0;
+    return true;
+}
+
+static bool bitset_to_array(BitmapContainer *c) {
+    uint16_t *arr = malloc((c->cardinality > 0 ? c->cardinality : 1) * sizeof(uint16_t));
+    if (!arr) return false;
+    const uint64_t *words = c->data;
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < BITSET_WORDS; w++) {
+        uint64_t bits = words[w];
+        while (bits) {
+            arr[n++] = (uint16_t)((w << 6) + (uint32_t)__builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+    free(c->data);
+    c->data = arr;
+    c->is_bitset = false;
+    c->capacity = c->cardinality > 0 ? c->cardinality : 1;
+    return true;
+}
+
+void bitmap_init(Bitmap *bm) {
+    bm->containers = NULL;
+    bm->count = 0;
+    bm->capacity = 0;
+}
+
+void bitmap_free(Bitmap *bm) {
+    for (uint32_t i = 0; i < bm->count; i++) {
+        container_free(&bm->containers[i]);
+    }
+    free(bm->containers);
+    bitmap_init(bm);
+}
+
+// Insert an empty array container for key at position pos
+static BitmapContainer* insert_container(Bitmap *bm, uint32_t pos, uint16_t key) {
+    if (bm->count == bm->capacity) {
+        uint32_t cap = bm->capacity ? bm->capacity * 2 : 4;
+        BitmapContainer *grown = realloc(bm->containers, cap * sizeof(BitmapContainer));
+        if (!grown) return NULL;
+        bm->containers = grown;
+        bm->capacity = cap;
+    }
+    memmove(&bm->containers[pos + 1], &bm->containers[pos],
+            (bm->count - pos) * sizeof(BitmapContainer));
+    BitmapContainer *c = &bm->containers[pos];
+    c->key = key;
+    c->is_bitset = false;
+    c->cardinality = 0;
+    c->capacity = 0;
+    c->data = NULL;
+    bm->count++;
+    return c;
+}
+
+static void remove_container(Bitmap *bm, uint32_t pos) {
+    container_free(&bm->containers[pos]);
+    memmove(&bm->containers[pos], &bm->containers[pos + 1],
+            (bm->count - pos - 1) * sizeof(BitmapContainer));
+    bm->count--;
+}
+
+bool bitmap_add(Bitmap *bm, uint32_t value) {
+    uint16_t key = (uint16_t)(value >> 16), low = (uint16_t)value;
+    int32_t idx = find_container(bm, key);
+    BitmapContainer *c = idx >= 0 ? &bm->containers[idx]
+                                  : insert_container(bm, (uint32_t)(-idx - 1), key);
+    if (!c) return false;
+
+    if (c->is_bitset) {
+        uint64_t *words = c->data;
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(words[low >> 6] & mask)) {
+            words[low >> 6] |= mask;
+            c->cardinality++;
+        }
+        return true;
+    }
+
+    int32_t pos = array_search(c->data, c->cardinality, low);
+    if (pos >= 0) return true;
+    pos = -pos - 1;
+
+    if (c->cardinality == BITMAP_ARRAY_MAX) {
+        return array_to_bitset(c) && bitmap_add(bm, value);
+    }
+    if (c->cardinality == c->capacity) {
+        uint32_t cap = c->capacity ? c->capacity * 2 : 4;
+        if (cap > BITMAP_ARRAY_MAX) cap = BITMAP_ARRAY_MAX;
+        uint16_t *grown = realloc(c->data, cap * sizeof(uint16_t));
+        if (!grown) return false;
+        c->data = grown;
+        c->capacity = cap;
+    }
+    uint16_t *arr = c->data;
+    memmove(&arr[pos + 1], &arr[pos], (c->cardinality - (uint32_t)pos) * sizeof(uint16_t));
+    arr[pos] = low;
+    c->cardinality++;
+    return true;
+}
+
+bool bitmap_remove(Bitmap *bm, uint32_t value) {
+    uint16_t key = (uint16_t)(value >> 16), low = (uint16_t)value;
+    int32_t idx = find_container(bm, key);
+    if (idx < 0) return false;
+    BitmapContainer *c = &bm->containers[idx];
+
+    if (c->is_bitset) {
+        uint64_t *words = c->data;
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(words[low >> 6] & mask)) return false;
+        words[low >> 6] &= ~mask;
+        c->cardinality--;
+        if (c->cardinality <= BITMAP_ARRAY_MAX / 2) bitset_to_array(c);
+    } else {
+        int32_t pos = array_search(c->data, c->cardinality, low);
+        if (pos < 0) return false;
+        uint16_t *arr = c->data;
+        memmove(&arr[pos], &arr[pos + 1], (c->cardinality - (uint32_t)pos - 1) * sizeof(uint16_t));
+        c->cardinality--;
+    }
+
+    if (c->cardinality == 0) remove_container(bm, (uint32_t)idx);
+    return true;
+}
+
+bool bitmap_contains(const Bitmap *bm, uint32_t value) {
+    uint16_t low = (uint16_t)value;
+    int32_t idx = find_container(bm, (uint16_t)(value >> 16));
+    if (idx < 0) return false;
+    const BitmapContainer *c = &bm->containers[idx];
+    if (c->is_bitset) {
+        return (((const uint64_t*)c->data)[low >> 6] >> (low & 63)) & 1;
+    }
+    return array_search(c->data, c->cardinality, low) >= 0;
+}
+
+uint32_t bitmap_cardinality(const Bitmap *bm) {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < bm->count; i++) {
+        total += bm->containers[i].cardinality;
+    }
+    return total;
+}
+
+// Intersect two containers with the same key into out (an empty container)
+static bool container_and(const BitmapContainer *a, const BitmapContainer *b, BitmapContainer *out) {
+    if (a->is_bitset && b->is_bitset) {
+        uint64_t *words = malloc(BITSET_WORDS * sizeof(uint64_t));
+        if (!words) return false;
+        const uint64_t *wa = a->data, *wb = b->data;
+        uint32_t card = 0;
+        for (uint32_t w = 0; w < BITSET_WORDS; w++) {
+            words[w] = wa[w] & wb[w];
+            card += (uint32_t)__builtin_popcountll(words[w]);
+        }
+        out->data = words;
+        out->is_bitset = true;
+        out->cardinality = card;
+        return card > BITMAP_ARRAY_MAX || bitset_to_array(out);
+    }
+
+    // At least one side is an array, so the result fits in an array
+    if (a->is_bitset) {
+        const BitmapContainer *t = a;
+        a = b;
+        b = t;
+    }
+    const uint16_t *arr = a->data;
+    uint16_t *result = malloc((a->cardinality > 0 ? a->cardinality : 1) * sizeof(uint16_t));
+    if (!result) return false;
+    uint32_t n = 0;
+
+    if (b->is_bitset) {
+        const uint64_t *words = b->data;
+        for (uint32_t i = 0; i < a->cardinality; i++) {
+            if ((words[arr[i] >> 6] >> (arr[i] & 63)) & 1) result[n++] = arr[i];
+        }
+    } else {
+        const uint16_t *other = b->data;
+        uint32_t i = 0, j = 0;
+        while (i < a->cardinality && j < b->cardinality) {
+            if (arr[i] < other[j]) i++;
+            else if (arr[i] > other[j]) j++;
+            else { result[n++] = arr[i]; i++; j++; }
+        }
+    }
+
+    out->data = result;
+    out->is_bitset = false;
+    out->cardinality = n;
+    out->capacity = a->cardinality > 0 ? a->cardinality : 1;
+    return true;
+}
+
+bool bitmap_and(const Bitmap *a, const Bitmap *b, Bitmap *out) {
+    bitmap_init(out);
+    uint32_t i = 0, j = 0;
+    while (i < a->count && j < b->count) {
+        const BitmapContainer *ca = &a->containers[i], *cb = &b->containers[j];
+        if (ca->key < cb->key) { i++; continue; }
+        if (ca->key > cb->key) { j++; continue; }
+
+        BitmapContainer result = { ca->key, false, 0, 0, NULL };
+        if (!container_and(ca, cb, &result)) {
+            bitmap_free(out);
+            return false;
+        }
+        if (result.cardinality == 0) {
+            container_free(&result);
+        } else {
+            BitmapContainer *slot = insert_container(out, out->count, ca->key);
+            if (!slot) {
+                container_free(&result);
+                bitmap_free(out);
+                return false;
+            }
+            *slot = result;
+        }
+        i++;
+        j++;
+    }
+    return true;
+}
+
+bool bitmap_copy(const Bitmap *src, Bitmap *dst) {
+    bitmap_init(dst);
+    for (uint32_t i = 0; i < src->count; i++) {
+        const BitmapContainer *c = &src->containers[i];
+        BitmapContainer *slot = insert_container(dst, dst->count, c->key);
+        if (!slot) {
+            bitmap_free(dst);
+            return false;
+        }
+        size_t bytes = c->is_bitset ? BITSET_WORDS * sizeof(uint64_t)
+                                    : (c->capacity ? c->capacity : 1) * sizeof(uint16_t);
+        slot->data = malloc(bytes);
+        if (!slot->data) {
+            bitmap_free(dst);
+            return false;
+        }
+        memcpy(slot->data, c->data, c->is_bitset ? bytes : c->cardinality * sizeof(uint16_t));
+        slot->is_bitset = c->is_bitset;
+        slot->cardinality = c->cardinality;
+        slot->capacity = c->capacity;
+    }
+    return true;
+}
+
+// Write all values in ascending order; out must hold bitmap_cardinality()
+uint32_t bitmap_to_array(const Bitmap *bm, uint32_t *out) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < bm->count; i++) {
+        const BitmapContainer *c = &bm->containers[i];
+        uint32_t high = (uint32_t)c->key << 16;
+        if (c->is_bitset) {
+            const uint64_t *words = c->data;
+            for (uint32_t w = 0; w < BITSET_WORDS; w++) {
+                uint64_t bits = words[w];
+                while (bits) {
+                    out[n++] = high | ((w << 6) + (uint32_t)__builtin_ctzll(bits));
+                    bits &= bits - 1;
+                }
+            }
+        } else {
+            const uint16_t *arr = c->data;
+            for (uint32_t k = 0; k < c->cardinality; k++) {
+                out[n++] = high | arr[k];
+            }
+        }
+    }
+    return n;
+}
+
+// Serialized form: container count, then per container key, kind,
+// cardinality and its payload
+bool bitmap_write(const Bitmap *bm, FILE *fp) {
+    if (fwrite(&bm->count, sizeof(bm->count), 1, fp) != 1) return false;
+    for (uint32_t i = 0; i < bm->count; i++) {
+        const BitmapContainer *c = &bm->containers[i];
+        uint8_t kind = c->is_bitset ? 1 : 0;
+        if (fwrite(&c->key, sizeof(c->key), 1, fp) != 1 ||
+            fwrite(&kind, sizeof(kind), 1, fp) != 1 ||
+            fwrite(&c->cardinality, sizeof(c->cardinality), 1, fp) != 1) {
+            return false;
+        }
+        size_t n = c->is_bitset ? BITSET_WORDS : c->cardinality;
+        size_t size = c->is_bitset ? sizeof(uint64_t) : sizeof(uint16_t);
+        if (fwrite(c->data, size, n, fp) != n) return false;
+    }
+    return true;
+}
+
+bool bitmap_read(Bitmap *bm, FILE *fp) {
+    bitmap_init(bm);
+    uint32_t count;
+    if (fread(&count, sizeof(count), 1, fp) != 1) return false;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t key;
+        uint8_t kind;
+        uint32_t card;
+        if (fread(&key, sizeof(key), 1, fp) != 1 ||
+            fread(&kind, sizeof(kind), 1, fp) != 1 ||
+            fread(&card, sizeof(card), 1, fp) != 1 ||
+            (kind == 0 && card > BITMAP_ARRAY_MAX)) {
+            bitmap_free(bm);
+            return false;
+        }
+
+        BitmapContainer *c = insert_container(bm, bm->count, key);
+        size_t n = kind ? BITSET_WORDS : (card > 0 ? card : 1);
+        size_t size = kind ? sizeof(uint64_t) : sizeof(uint16_t);
+        if (!c || !(c->data = malloc(n * size))) {
+            bitmap_free(bm);
+            return false;
+        }
+        c->is_bitset = kind != 0;
+        c->cardinality = card;
+        c->capacity = kind ? 0 : (uint32_t)n;
+        size_t want = kind ? BITSET_WORDS : card;
+        if (fread(c->data, size, want, fp) != want) {
+            bitmap_free(bm);
+            return false;
+        }
+    }
+    return true;
+}
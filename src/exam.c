@@ -1,42 +1,333 @@
 #include "../include/exam.h"
 #include "../include/common.h"
 #include "../include/logger.h"
+#include "../include/file_lock.h"
+#include "../include/exam_catalog.h"
+#include "../include/question_bank.h"
+#include "../include/exam_schedule.h"
+#include "../include/scoring.h"
+#include "../include/exam_shuffle.h"
+#include <errno.h>
+#include <stddef.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-#define EXAM_DATA_FILE "data/exams.dat"
-#define EXAM_SCHEDULE_FILE "data/exam_schedule.dat"
+// Catalog of the pre-question-bank data file
+#define LEGACY_CATALOG_FILE "data/exams.cat"
+
+// The stored form of a paper, with each of its questions interned in the
+// question bank
+static bool to_record(const ExamPaper* paper, PaperRecord* rec) {
+    memset(rec, 0, sizeof(*rec));
+    rec->paper_id = paper->paper_id;
+    memcpy(rec->title, paper->title, sizeof(rec->title));
+    memcpy(rec->subject, paper->subject, sizeof(rec->subject));
+    rec->num_questions = paper->num_questions;
+    if (rec->num_questions < 0) rec->num_questions = 0;
+    if (rec->num_questions > MAX_QUESTIONS_PER_PAPER) rec->num_questions = MAX_QUESTIONS_PER_PAPER;
+    rec->total_marks = paper->total_marks;
+    rec->duration_minutes = paper->duration_minutes;
+    rec->exam_date = (int64_t)paper->exam_date;
+    rec->is_active = paper->is_active;
+
+    for (int i = 0; i < rec->num_questions; i++) {
+        rec->question_ids[i] = question_bank_intern(&paper->questions[i]);
+        if (rec->question_ids[i] == 0) {
+            log_message(LOG_ERROR, "Failed to store question %d of exam paper %d", i + 1, paper->paper_id);
+            return false;
+        }
+    }
+    return true;
+}
 
-static int get_next_paper_id(void) {
-    FILE* fp = fopen(EXAM_DATA_FILE, "rb");
-    if (!fp) return 1;  // Start with ID 1 if file doesn't exist
+// The full paper, with its questions fetched from the question bank
+static bool assemble(const PaperRecord* rec, ExamPaper* paper) {
+    if (rec->num_questions < 0 || rec->num_questions > MAX_QUESTIONS_PER_PAPER) return false;
+
+    memset(paper, 0, sizeof(*paper));
+    paper->paper_id = rec->paper_id;
+    memcpy(paper->title, rec->title, sizeof(paper->title));
+    memcpy(paper->subject, rec->subject, sizeof(paper->subject));
+    paper->num_questions = rec->num_questions;
+    paper->total_marks = rec->total_marks;
+    paper->duration_minutes = rec->duration_minutes;
+    paper->exam_date = (time_t)rec->exam_date;
+    paper->is_active = rec->is_active != 0;
+
+    for (int i = 0; i < rec->num_questions; i++) {
+        if (!question_bank_load(rec->question_ids[i], &paper->questions[i])) {
+            log_message(LOG_ERROR, "Exam paper %d refers to missing question %d",
+                        rec->paper_id, rec->question_ids[i]);
+            return false;
+        }
+    }
+    return true;
+}
 
-    ExamPaper paper;
-    int max_id = 0;
+// Convert the legacy data file, whose records held every question inline,
+// into paper records in a new EXAM_DATA_FILE
+static bool migrate_papers(int legacy_fd) {
+    const char* tmp_path = EXAM_DATA_FILE ".tmp";
+    FILE* out = fopen(tmp_path, "wb");
+    ExamPaper* paper = malloc(sizeof(ExamPaper));
+    if (!out || !paper) {
+        if (out) fclose(out);
+        free(paper);
+        log_message(LOG_ERROR, "Failed to create %s", tmp_path);
+        return false;
+    }
 
-    while (fread(&paper, sizeof(ExamPaper), 1, fp) == 1) {
-        if (paper.paper_id > max_id) {
-            max_id = paper.paper_id;
+    long count = 0;
+    bool ok = true;
+    for (off_t at = 0; ok && pread(legacy_fd, paper, sizeof(ExamPaper), at) == (ssize_t)sizeof(ExamPaper);
+         at += (off_t)sizeof(ExamPaper)) {
+        PaperRecord rec;
+        ok = to_record(paper, &rec) && fwrite(&rec, sizeof(rec), 1, out) == 1;
+        count++;
+    }
+    free(paper);
+
+    ok = fflush(out) == 0 && fsync(fileno(out)) == 0 && ok;
+    ok = fclose(out) == 0 && ok;
+    if (!ok) {
+        unlink(tmp_path);
+        log_message(LOG_ERROR, "Failed to convert exam papers to the question bank");
+        return false;
+    }
+    if (!replace_file(tmp_path, EXAM_DATA_FILE)) return false;
+
+    // Keep the old file around rather than deleting anyone's papers
+    if (rename(EXAM_LEGACY_FILE, EXAM_LEGACY_FILE ".migrated") != 0) {
+        log_message(LOG_WARNING, "Failed to rename %s after conversion", EXAM_LEGACY_FILE);
+    }
+    unlink(LEGACY_CATALOG_FILE);
+    log_message(LOG_INFO, "Converted %ld exam papers; question bank holds %d questions",
+                count, question_bank_count());
+    return true;
+}
+
+// Convert a legacy data file before EXAM_DATA_FILE is first used. The
+// terminal that wins the legacy file's lock does the work; the others find
+// it done once they get the lock.
+static bool ensure_migrated(void) {
+    static bool checked = false;
+    if (checked) return true;
+    if (FILE_EXISTS(EXAM_DATA_FILE) || !FILE_EXISTS(EXAM_LEGACY_FILE)) {
+        checked = true;
+        return true;
+    }
+
+    int fd = open(EXAM_LEGACY_FILE, O_RDWR);
+    if (fd < 0) {
+        checked = true;  // Converted and renamed in the meantime
+        return true;
+    }
+    bool ok = file_lock(fd, 0, FILE_LOCK_WHOLE, FILE_LOCK_EXCLUSIVE);
+    if (ok && file_is_current(fd, EXAM_LEGACY_FILE) && !FILE_EXISTS(EXAM_DATA_FILE)) {
+        ok = migrate_papers(fd);
+    }
+    close(fd);
+
+    checked = ok;
+    return ok;
+}
+
+// Open the exam data file and lock a range of it. Compaction renames a new
+// file into place, so a lock won on the replaced one is dropped and retaken.
+static int open_locked(int flags, off_t start, off_t len, FileLockMode mode) {
+    if (!ensure_migrated()) return -1;
+    for (;;) {
+        int fd = open(EXAM_DATA_FILE, flags, 0644);
+        if (fd < 0) return -1;
+        if (!file_lock(fd, start, len, mode)) {
+            close(fd);
+            return -1;
         }
+        if (file_is_current(fd, EXAM_DATA_FILE)) return fd;
+        close(fd);
     }
+}
 
-    fclose(fp);
-    return max_id + 1;
+// Readers share a lock over every record; they only wait for writers
+static int open_for_reading(void) {
+    return open_locked(O_RDONLY, 0, FILE_LOCK_RECORDS, FILE_LOCK_SHARED);
+}
+
+static int paper_id_at(int fd, off_t pos) {
+    int32_t id;
+    if (pread(fd, &id, sizeof(id), pos + (off_t)offsetof(PaperRecord, paper_id)) != (ssize_t)sizeof(id)) {
+        return -1;
+    }
+    return id;
+}
+
+// Where the last paper looked up was found. Papers are edited one at a
+// time, so successive edits usually skip reading the catalog.
+static int last_found_id = 0;
+static off_t last_found_pos = -1;
+
+// Offset of the paper's record, or -1. Runs without locks, so the catalog
+// is only a hint and the IDs are scanned if it misses; callers lock the
+// record they find and check it again.
+static off_t find_paper(int fd, int paper_id) {
+    if (paper_id == last_found_id && paper_id_at(fd, last_found_pos) == paper_id) {
+        return last_found_pos;
+    }
+
+    off_t found = -1;
+    int count = 0;
+    PaperSummary* entries = exam_catalog_read(&count);
+    for (int i = 0; i < count && found < 0; i++) {
+        if (entries[i].paper_id == paper_id && paper_id_at(fd, entries[i].offset) == paper_id) {
+            found = entries[i].offset;
+        }
+    }
+    free(entries);
+
+    off_t end = found < 0 ? lseek(fd, 0, SEEK_END) : 0;
+    for (off_t pos = 0; pos + (off_t)sizeof(PaperRecord) <= end && found < 0; pos += (off_t)sizeof(PaperRecord)) {
+        if (paper_id_at(fd, pos) == paper_id) found = pos;
+    }
+
+    if (found >= 0) {
+        last_found_id = paper_id;
+        last_found_pos = found;
+    }
+    return found;
+}
+
+// Highest paper ID in use, from the catalog. The caller keeps record
+// writers out, as exam_catalog_load() requires.
+static int max_paper_id(int fd) {
+    int count = 0, max_id = 0;
+    PaperSummary* entries = exam_catalog_load(fd, &count);
+    if (entries) {
+        for (int i = 0; i < count; i++) {
+            if (entries[i].paper_id > max_id) max_id = entries[i].paper_id;
+        }
+        free(entries);
+        return max_id;
+    }
+
+    // No usable catalog; fall back to reading every ID
+    off_t end = lseek(fd, 0, SEEK_END);
+    for (off_t pos = 0; pos + (off_t)sizeof(PaperRecord) <= end; pos += (off_t)sizeof(PaperRecord)) {
+        int id = paper_id_at(fd, pos);
+        if (id > max_id) max_id = id;
+    }
+    return max_id;
+}
+
+#define PAPER_NOT_FOUND (-2)
+
+// Lock the paper's record for writing. Returns the descriptor holding the
+// lock, with the record's offset in *pos, PAPER_NOT_FOUND if there is no
+// such paper, or -1 if the file could not be opened or locked.
+static int lock_paper_record(int paper_id, off_t* pos) {
+    if (!ensure_migrated()) return -1;
+    for (;;) {
+        int fd = open(EXAM_DATA_FILE, O_RDWR);
+        if (fd < 0) return errno == ENOENT ? PAPER_NOT_FOUND : -1;
+
+        off_t at = find_paper(fd, paper_id);
+        if (at < 0) {
+            close(fd);
+            return PAPER_NOT_FOUND;
+        }
+        if (!file_lock(fd, at, sizeof(PaperRecord), FILE_LOCK_EXCLUSIVE)) {
+            close(fd);
+            return -1;
+        }
+        // Compaction may have swapped the file out before the lock was won
+        if (file_is_current(fd, EXAM_DATA_FILE) && paper_id_at(fd, at) == paper_id) {
+            *pos = at;
+            return fd;
+        }
+        close(fd);
+    }
+}
+
+// Bring the catalog and schedule up to date with the record just written
+// at pos, while its lock is still held
+static void index_paper(off_t pos, const PaperRecord* rec) {
+    long recno = (long)(pos / (off_t)sizeof(PaperRecord));
+    exam_catalog_put(recno, rec);
+    exam_schedule_put(recno, rec);
+}
+
+static bool write_record(const PaperRecord* rec, bool append_if_missing);
+
+// Append a paper under the append lock. With allocate_id the paper gets
+// max + 1 as its ID, chosen under the same lock so two terminals never
+// hand out the same one.
+static bool append_paper(PaperRecord* rec, bool allocate_id) {
+    int fd = open_locked(O_RDWR | O_CREAT, FILE_LOCK_APPEND_BYTE, 1, FILE_LOCK_EXCLUSIVE);
+    if (fd < 0) {
+        log_message(LOG_ERROR, "Failed to open exam data file for writing");
+        return false;
+    }
+
+    if (allocate_id) {
+        // Keep record writers out while the catalog is read (or rebuilt)
+        if (!file_lock(fd, 0, FILE_LOCK_RECORDS, FILE_LOCK_SHARED)) {
+            close(fd);
+            return false;
+        }
+        rec->paper_id = max_paper_id(fd) + 1;
+        file_unlock(fd, 0, FILE_LOCK_RECORDS);
+    } else if (find_paper(fd, rec->paper_id) >= 0) {
+        // Another terminal appended it first; update that record instead
+        close(fd);
+        return write_record(rec, false);
+    }
+
+    // Lock the new record too, so readers never see it half written. A
+    // partial record left at the end by a crash is overwritten.
+    off_t end = lseek(fd, 0, SEEK_END);
+    if (end > 0) end -= end % (off_t)sizeof(PaperRecord);
+    bool ok = end >= 0 && file_lock(fd, end, sizeof(PaperRecord), FILE_LOCK_EXCLUSIVE) &&
+              pwrite(fd, rec, sizeof(PaperRecord), end) == (ssize_t)sizeof(PaperRecord);
+    if (ok) index_paper(end, rec);
+    close(fd);
+
+    if (!ok) log_message(LOG_ERROR, "Failed to write exam paper to file");
+    return ok;
+}
+
+// Update the existing record in place, locking only that record, or
+// append it if the paper is not stored and append_if_missing is set
+static bool write_record(const PaperRecord* rec, bool append_if_missing) {
+    off_t pos;
+    int fd = lock_paper_record(rec->paper_id, &pos);
+    if (fd == PAPER_NOT_FOUND && append_if_missing) {
+        PaperRecord copy = *rec;
+        return append_paper(&copy, false);
+    }
+    if (fd < 0) {
+        log_message(LOG_ERROR, "Failed to lock exam paper %d for writing", rec->paper_id);
+        return false;
+    }
+
+    bool ok = pwrite(fd, rec, sizeof(PaperRecord), pos) == (ssize_t)sizeof(PaperRecord);
+    if (ok) index_paper(pos, rec);
+    close(fd);
+
+    if (!ok) log_message(LOG_ERROR, "Failed to write exam paper to file");
+    return ok;
 }
 
 bool initialize_exam_system(void) {
-    FILE* fp = fopen(EXAM_DATA_FILE, "ab");
-    if (!fp) {
-        log_message(LOG_ERROR, "Failed to initialize exam system: Cannot create exam data file");
+    if (!ensure_migrated()) {
+        log_message(LOG_ERROR, "Failed to initialize exam system: Cannot convert exam data file");
         return false;
     }
-    fclose(fp);
 
-    fp = fopen(EXAM_SCHEDULE_FILE, "ab");
+    FILE* fp = fopen(EXAM_DATA_FILE, "ab");
     if (!fp) {
-        log_message(LOG_ERROR, "Failed to initialize exam system: Cannot create exam schedule file");
+        log_message(LOG_ERROR, "Failed to initialize exam system: Cannot create exam data file");
         return false;
     }
     fclose(fp);
@@ -52,14 +343,15 @@ ExamPaper* create_new_paper(const char* title, const char* subject, int duration
     }
 
     memset(paper, 0, sizeof(ExamPaper));
-    paper->paper_id = get_next_paper_id();
     strncpy(paper->title, title, MAX_TITLE_LENGTH - 1);
     strncpy(paper->subject, subject, MAX_SUBJECT_LENGTH - 1);
     paper->duration_minutes = duration;
     paper->num_questions = 0;
     paper->is_active = true;
 
-    if (save_exam_paper(paper)) {
+    PaperRecord rec;
+    if (to_record(paper, &rec) && append_paper(&rec, true)) {
+        paper->paper_id = rec.paper_id;
         log_message(LOG_INFO, "Created new exam paper: %s (ID: %d)", title, paper->paper_id);
         return paper;
     }
@@ -71,67 +363,43 @@ ExamPaper* create_new_paper(const char* title, const char* subject, int duration
 bool save_exam_paper(const ExamPaper* paper) {
     if (!paper) return false;
 
-    FILE* fp = fopen(EXAM_DATA_FILE, "r+b");
-    if (!fp) {
-        fp = fopen(EXAM_DATA_FILE, "wb");
-        if (!fp) {
-            log_message(LOG_ERROR, "Failed to open exam data file for writing");
-            return false;
-        }
-    }
-
-    // Try to find and update existing paper
-    ExamPaper existing;
-    bool found = false;
-    long pos = 0;
-
-    while (fread(&existing, sizeof(ExamPaper), 1, fp) == 1) {
-        if (existing.paper_id == paper->paper_id) {
-            fseek(fp, pos, SEEK_SET);
-            found = true;
-            break;
-        }
-        pos = ftell(fp);
-    }
-
-    if (!found) {
-        fseek(fp, 0, SEEK_END);
-    }
-
-    if (fwrite(paper, sizeof(ExamPaper), 1, fp) != 1) {
-        log_message(LOG_ERROR, "Failed to write exam paper to file");
-        fclose(fp);
-        return false;
-    }
+    // Questions go into the bank first, outside any record lock
+    PaperRecord rec;
+    return to_record(paper, &rec) && write_record(&rec, true);
+}
 
-    fclose(fp);
-    return true;
+// Read the record an index entry points at and check it is the paper's
+static bool read_record(int fd, off_t offset, int paper_id, PaperRecord* rec) {
+    return pread(fd, rec, sizeof(*rec), offset) == (ssize_t)sizeof(*rec) && rec->paper_id == paper_id;
 }
 
 bool load_exam_paper(int paper_id, ExamPaper* paper) {
     if (!paper) return false;
 
-    FILE* fp = fopen(EXAM_DATA_FILE, "rb");
-    if (!fp) {
+    int fd = open_for_reading();
+    if (fd < 0) {
         log_message(LOG_ERROR, "Failed to open exam data file for reading");
         return false;
     }
 
+    int count = 0;
+    PaperSummary* entries = exam_catalog_load(fd, &count);
     bool found = false;
-    ExamPaper temp;
-
-    while (fread(&temp, sizeof(ExamPaper), 1, fp) == 1) {
-        if (temp.paper_id == paper_id) {
-            memcpy(paper, &temp, sizeof(ExamPaper));
-            found = true;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].paper_id == paper_id) {
+            PaperRecord rec;
+            found = read_record(fd, entries[i].offset, paper_id, &rec) && assemble(&rec, paper);
             break;
         }
     }
 
-    fclose(fp);
+    free(entries);
+    close(fd);
     return found;
 }
 
+// Appends the question's ID to the stored paper, rewriting only its small
+// record, and mirrors the change into *paper
 bool add_question_to_paper(ExamPaper* paper, const Question* question) {
     if (!paper || !question) return false;
     if (paper->num_questions >= MAX_QUESTIONS_PER_PAPER) {
@@ -139,120 +407,413 @@ bool add_question_to_paper(ExamPaper* paper, const Question* question) {
         return false;
     }
 
-    memcpy(&paper->questions[paper->num_questions], question, sizeof(Question));
-    paper->num_questions++;
-    paper->total_marks += question->marks;
+    int question_id = question_bank_intern(question);
+    if (question_id == 0) return false;
+
+    off_t pos;
+    int fd = lock_paper_record(paper->paper_id, &pos);
+    if (fd == -1) return false;
+    if (fd == PAPER_NOT_FOUND) {
+        // Not stored yet; save the whole paper with the question added
+        paper->questions[paper->num_questions] = *question;
+        paper->questions[paper->num_questions].question_id = question_id;
+        paper->num_questions++;
+        paper->total_marks += question->marks;
+        return save_exam_paper(paper);
+    }
 
-    return save_exam_paper(paper);
+    PaperRecord rec;
+    bool ok = pread(fd, &rec, sizeof(rec), pos) == (ssize_t)sizeof(rec);
+    if (ok && (rec.num_questions < 0 || rec.num_questions >= MAX_QUESTIONS_PER_PAPER)) {
+        log_message(LOG_ERROR, "Cannot add more questions: paper is full");
+        ok = false;
+    }
+    if (ok) {
+        rec.question_ids[rec.num_questions++] = question_id;
+        rec.total_marks += question->marks;
+        ok = pwrite(fd, &rec, sizeof(rec), pos) == (ssize_t)sizeof(rec);
+        if (ok) {
+            index_paper(pos, &rec);
+        } else {
+            log_message(LOG_ERROR, "Failed to write exam paper to file");
+        }
+    }
+    close(fd);
+    if (!ok) return false;
+
+    // Another terminal may have changed the paper since it was loaded
+    if (rec.num_questions == paper->num_questions + 1) {
+        paper->questions[paper->num_questions] = *question;
+        paper->questions[paper->num_questions].question_id = question_id;
+        paper->num_questions = rec.num_questions;
+        paper->total_marks = rec.total_marks;
+        return true;
+    }
+    return assemble(&rec, paper);
 }
 
-bool delete_exam_paper(int paper_id) {
-    FILE* fp = fopen(EXAM_DATA_FILE, "r+b");
-    if (!fp) return false;
+// Rewrite one paper record in place under its lock, re-reading it first.
+// The change may refuse by returning false, leaving the record as it was.
+// The record as written is copied to *result if given.
+static bool update_paper_record(int paper_id, bool (*change)(PaperRecord* rec, const void* arg),
+                                const void* arg, PaperRecord* result) {
+    off_t pos;
+    int fd = lock_paper_record(paper_id, &pos);
+    if (fd < 0) return false;
+
+    PaperRecord rec;
+    bool ok = pread(fd, &rec, sizeof(rec), pos) == (ssize_t)sizeof(rec) && change(&rec, arg);
+    if (ok) {
+        ok = pwrite(fd, &rec, sizeof(rec), pos) == (ssize_t)sizeof(rec);
+        if (ok) {
+            index_paper(pos, &rec);
+        } else {
+            log_message(LOG_ERROR, "Failed to write exam paper to file");
+        }
+    }
+    close(fd);
 
-    ExamPaper paper;
-    bool found = false;
-    long pos = 0;
+    if (ok && result) *result = rec;
+    return ok;
+}
 
-    while (fread(&paper, sizeof(ExamPaper), 1, fp) == 1) {
-        if (paper.paper_id == paper_id) {
-            paper.is_active = false;
-            fseek(fp, pos, SEEK_SET);
-            found = fwrite(&paper, sizeof(ExamPaper), 1, fp) == 1;
-            break;
-        }
-        pos = ftell(fp);
+static bool set_inactive(PaperRecord* rec, const void* arg) {
+    (void)arg;
+    rec->is_active = false;
+    return true;
+}
+
+static bool set_exam_date(PaperRecord* rec, const void* arg) {
+    rec->exam_date = (int64_t)*(const time_t*)arg;
+    return true;
+}
+
+typedef struct {
+    int index;
+    int expected_id;     // The question the caller saw at index
+    int question_id;     // Its replacement, or 0 to remove it
+    int marks;           // Of the replacement
+} QuestionEdit;
+
+static bool edit_question(PaperRecord* rec, const void* arg) {
+    const QuestionEdit* edit = arg;
+    if (edit->index < 0 || edit->index >= rec->num_questions ||
+        rec->question_ids[edit->index] != edit->expected_id) {
+        log_message(LOG_WARNING, "Exam paper %d was changed on another terminal; reload it and retry",
+                    rec->paper_id);
+        return false;
     }
 
-    fclose(fp);
+    Question old;
+    if (!question_bank_load(edit->expected_id, &old)) return false;
+    rec->total_marks -= old.marks;
+
+    if (edit->question_id != 0) {
+        rec->question_ids[edit->index] = edit->question_id;
+        rec->total_marks += edit->marks;
+    } else {
+        memmove(&rec->question_ids[edit->index], &rec->question_ids[edit->index + 1],
+                (size_t)(rec->num_questions - edit->index - 1) * sizeof(rec->question_ids[0]));
+        rec->num_questions--;
+        rec->question_ids[rec->num_questions] = 0;
+    }
+    return true;
+}
+
+typedef struct {
+    const char* title;
+    const char* subject;
+    int duration;
+} PaperDetails;
+
+static bool set_details(PaperRecord* rec, const void* arg) {
+    const PaperDetails* details = arg;
+    if (details->title) {
+        strncpy(rec->title, details->title, MAX_TITLE_LENGTH - 1);
+        rec->title[MAX_TITLE_LENGTH - 1] = '\0';
+    }
+    if (details->subject) {
+        strncpy(rec->subject, details->subject, MAX_SUBJECT_LENGTH - 1);
+        rec->subject[MAX_SUBJECT_LENGTH - 1] = '\0';
+    }
+    if (details->duration > 0) rec->duration_minutes = details->duration;
+    return true;
+}
+
+// Swap the question at index for another, touching only that slot of the
+// stored record. Fails if the stored paper no longer has the caller's
+// question there.
+bool replace_question_in_paper(ExamPaper* paper, int index, const Question* question) {
+    if (!paper || !question || index < 0 || index >= paper->num_questions) return false;
+
+    int question_id = question_bank_intern(question);
+    if (question_id == 0) return false;
+
+    QuestionEdit edit = { index, paper->questions[index].question_id, question_id, question->marks };
+    PaperRecord rec;
+    if (!update_paper_record(paper->paper_id, edit_question, &edit, &rec)) return false;
+
+    if (rec.num_questions != paper->num_questions) return assemble(&rec, paper);
+    paper->questions[index] = *question;
+    paper->questions[index].question_id = question_id;
+    paper->total_marks = rec.total_marks;
+    return true;
+}
+
+bool remove_question_from_paper(ExamPaper* paper, int index) {
+    if (!paper || index < 0 || index >= paper->num_questions) return false;
+
+    QuestionEdit edit = { index, paper->questions[index].question_id, 0, 0 };
+    PaperRecord rec;
+    if (!update_paper_record(paper->paper_id, edit_question, &edit, &rec)) return false;
+
+    if (rec.num_questions != paper->num_questions - 1) return assemble(&rec, paper);
+    memmove(&paper->questions[index], &paper->questions[index + 1],
+            (size_t)(paper->num_questions - index - 1) * sizeof(Question));
+    paper->num_questions = rec.num_questions;
+    paper->total_marks = rec.total_marks;
+    memset(&paper->questions[paper->num_questions], 0, sizeof(Question));
+    return true;
+}
+
+// Change a paper's title, subject or duration without touching its
+// questions. NULL strings and a duration of 0 leave that field as it is.
+bool update_paper_details(ExamPaper* paper, const char* title, const char* subject, int duration) {
+    if (!paper) return false;
+
+    PaperDetails details = { title, subject, duration };
+    PaperRecord rec;
+    if (!update_paper_record(paper->paper_id, set_details, &details, &rec)) return false;
+
+    memcpy(paper->title, rec.title, sizeof(paper->title));
+    memcpy(paper->subject, rec.subject, sizeof(paper->subject));
+    paper->duration_minutes = rec.duration_minutes;
+    return true;
+}
+
+bool delete_exam_paper(int paper_id) {
+    bool found = update_paper_record(paper_id, set_inactive, NULL, NULL);
     if (found) {
         log_message(LOG_INFO, "Deleted exam paper ID: %d", paper_id);
     }
     return found;
 }
 
+// Rewrite the exam data file without deleted papers and swap it in. The
+// paper with the highest ID is always kept, deleted or not: IDs are handed
+// out as max + 1 and the schedule refers to papers by ID, so dropping it
+// would let a new paper inherit an old schedule entry. The old file stays
+// locked until the new one has replaced it. Questions stay in the bank.
+bool compact_exam_papers(CompactionStats* stats) {
+    if (!ensure_migrated()) return false;
+    if (!FILE_EXISTS(EXAM_DATA_FILE)) return true;  // Nothing to compact
+    int fd = open_locked(O_RDWR, 0, FILE_LOCK_WHOLE, FILE_LOCK_EXCLUSIVE);
+    FILE* in = fd >= 0 ? fdopen(fd, "rb") : NULL;
+    if (!in) {
+        if (fd >= 0) close(fd);
+        log_message(LOG_ERROR, "Failed to lock exam data file for compaction");
+        return false;
+    }
+
+    int max_id = max_paper_id(fd);
+    const char* tmp_path = EXAM_DATA_FILE ".tmp";
+    FILE* out = fopen(tmp_path, "wb");
+    if (!out) {
+        fclose(in);
+        log_message(LOG_ERROR, "Failed to create %s", tmp_path);
+        return false;
+    }
+
+    PaperRecord rec;
+    long before = 0, after = 0;
+    bool ok = true;
+    while (ok && fread(&rec, sizeof(rec), 1, in) == 1) {
+        before++;
+        if (!rec.is_active && rec.paper_id != max_id) continue;
+        ok = fwrite(&rec, sizeof(rec), 1, out) == 1;
+        after++;
+    }
+
+    ok = fflush(out) == 0 && fsync(fileno(out)) == 0 && ok;
+    ok = fclose(out) == 0 && ok;
+    if (!ok) {
+        fclose(in);
+        unlink(tmp_path);
+        log_message(LOG_ERROR, "Failed to write compacted exam data file");
+        return false;
+    }
+    // Record offsets change; the catalog is rebuilt from the new file on
+    // next use, and a crash before the swap leaves none to mislead
+    exam_catalog_remove();
+    exam_schedule_remove();
+    ok = replace_file(tmp_path, EXAM_DATA_FILE);
+    fclose(in);
+    if (!ok) return false;
+
+    if (stats) {
+        stats->records_before = before;
+        stats->records_after = after;
+        stats->bytes_before = (long long)before * (long long)sizeof(PaperRecord);
+        stats->bytes_after = (long long)after * (long long)sizeof(PaperRecord);
+    }
+    log_message(LOG_INFO, "Compacted exam papers: %ld -> %ld records", before, after);
+    return true;
+}
+
+// Only the record's date changes; the questions are left alone
 bool assign_paper_to_date(int paper_id, time_t exam_date) {
-    ExamPaper paper;
-    if (!load_exam_paper(paper_id, &paper)) {
+    if (!update_paper_record(paper_id, set_exam_date, &exam_date, NULL)) {
         log_message(LOG_ERROR, "Failed to load exam paper for assignment");
         return false;
     }
-
-    paper.exam_date = exam_date;
-    return save_exam_paper(&paper);
+    return true;
 }
 
 ExamPaper* get_paper_for_date(time_t date) {
-    FILE* fp = fopen(EXAM_DATA_FILE, "rb");
-    if (!fp) return NULL;
+    int fd = open_for_reading();
+    if (fd < 0) return NULL;
 
+    int32_t day = exam_schedule_day(date);
+    int count = 0;
+    ScheduleEntry* entries = exam_schedule_load(fd, day, day, &count);
     ExamPaper* paper = NULL;
-    ExamPaper temp;
-
-    while (fread(&temp, sizeof(ExamPaper), 1, fp) == 1) {
-        // Compare dates ignoring time
-        struct tm* temp_tm = localtime(&temp.exam_date);
-        struct tm* date_tm = localtime(&date);
-
-        if (temp_tm->tm_year == date_tm->tm_year &&
-            temp_tm->tm_mon == date_tm->tm_mon &&
-            temp_tm->tm_mday == date_tm->tm_mday &&
-            temp.is_active) {
-            paper = (ExamPaper*)malloc(sizeof(ExamPaper));
-            if (paper) {
-                memcpy(paper, &temp, sizeof(ExamPaper));
-            }
-            break;
+
+    for (int i = 0; i < count && !paper; i++) {
+        PaperRecord rec;
+        if (!read_record(fd, entries[i].offset, entries[i].paper_id, &rec) || !rec.is_active ||
+            exam_schedule_day((time_t)rec.exam_date) != day) {
+            continue;
+        }
+        paper = (ExamPaper*)malloc(sizeof(ExamPaper));
+        if (paper && !assemble(&rec, paper)) {
+            free(paper);
+            paper = NULL;
         }
     }
 
-    fclose(fp);
+    free(entries);
+    close(fd);
     return paper;
 }
 
+// Papers scheduled from the day of from through the following days - 1
+// days, for the scheduling screen
+bool list_scheduled_papers(time_t from, int days) {
+    if (days < 1) return false;
+    int fd = open_for_reading();
+    if (fd < 0) {
+        log_message(LOG_ERROR, "No exam papers found");
+        return false;
+    }
+
+    int32_t first_day = exam_schedule_day(from);
+    int count = 0;
+    ScheduleEntry* entries = exam_schedule_load(fd, first_day, first_day + days - 1, &count);
+    bool found = false;
+
+    printf("\nExam Schedule (next %d days):\n", days);
+    printf("%-12s %-5s %-30s %-15s %-10s %-8s\n", "Date", "ID", "Title", "Subject", "Questions", "Minutes");
+    printf("--------------------------------------------------------------------------------\n");
+
+    size_t head = offsetof(PaperRecord, question_ids);
+    for (int i = 0; i < count; i++) {
+        PaperRecord rec;
+        if (pread(fd, &rec, head, entries[i].offset) != (ssize_t)head ||
+            rec.paper_id != entries[i].paper_id || !rec.is_active) {
+            continue;
+        }
+        char date_str[20];
+        time_t exam_date = (time_t)rec.exam_date;
+        struct tm exam_tm;
+        strftime(date_str, sizeof(date_str), "%Y-%m-%d", localtime_r(&exam_date, &exam_tm));
+        printf("%-12s %-5d %-30s %-15s %-10d %-8d\n",
+               date_str, rec.paper_id, rec.title, rec.subject, rec.num_questions, rec.duration_minutes);
+        found = true;
+    }
+    if (!found) printf("No papers scheduled.\n");
+
+    free(entries);
+    close(fd);
+    return found;
+}
+
 bool list_available_papers(void) {
-    FILE* fp = fopen(EXAM_DATA_FILE, "rb");
-    if (!fp) {
+    int fd = open_for_reading();
+    if (fd < 0) {
         log_message(LOG_ERROR, "No exam papers found");
         return false;
     }
 
-    ExamPaper paper;
+    int count = 0;
+    PaperSummary* entries = exam_catalog_load(fd, &count);
+    close(fd);
     bool found = false;
 
     printf("\nAvailable Exam Papers:\n");
     printf("%-5s %-30s %-15s %-10s %-20s\n", "ID", "Title", "Subject", "Questions", "Exam Date");
     printf("----------------------------------------------------------------\n");
 
-    while (fread(&paper, sizeof(ExamPaper), 1, fp) == 1) {
-        if (paper.is_active) {
+    for (int i = 0; i < count; i++) {
+        const PaperSummary* paper = &entries[i];
+        if (paper->is_active) {
             char date_str[20] = "Not scheduled";
-            if (paper.exam_date > 0) {
-                strftime(date_str, sizeof(date_str), "%Y-%m-%d", localtime(&paper.exam_date));
+            if (paper->exam_date > 0) {
+                time_t exam_date = (time_t)paper->exam_date;
+                strftime(date_str, sizeof(date_str), "%Y-%m-%d", localtime(&exam_date));
             }
             printf("%-5d %-30s %-15s %-10d %-20s\n",
-                   paper.paper_id, paper.title, paper.subject,
-                   paper.num_questions, date_str);
+                   paper->paper_id, paper->title, paper->subject,
+                   paper->num_questions, date_str);
             found = true;
         }
     }
 
-    fclose(fp);
+    free(entries);
     return found;
 }
 
 // Basic implementation of exam taking functionality
-bool start_exam(int student_id, ExamPaper* paper) {
+bool start_exam(int student_id, const ExamPaper* paper) {
     if (!paper) return false;
 
     log_message(LOG_INFO, "Student %d started exam: %s", student_id, paper->title);
     return true;
 }
 
-bool submit_exam(int student_id, const ExamPaper* paper, int* answers) {
+// paper is the stored paper; answers holds the option slot chosen at each
+// position of the candidate's shuffled view of it, -1 if skipped. The
+// result also goes to *score if given.
+bool submit_exam(int student_id, const ExamPaper* paper, int* answers, ExamScore* score) {
     if (!paper || !answers) return false;
 
-    // TODO: Implement exam submission and scoring logic
-    log_message(LOG_INFO, "Student %d submitted exam: %s", student_id, paper->title);
+    AnswerKey key;
+    if (!scoring_compile_key(paper, scoring_negative_fraction(), &key)) return false;
+    return submit_exam_with_key(student_id, paper, &key, answers, score);
+}
+
+// As submit_exam(), with the paper's key compiled beforehand, for callers
+// that score many candidates on one paper
+bool submit_exam_with_key(int student_id, const ExamPaper* paper, const AnswerKey* key,
+                          int* answers, ExamScore* score) {
+    if (!paper || !key || !answers) return false;
+    if (key->paper_id != paper->paper_id) {
+        log_message(LOG_ERROR, "Answer key for paper %d cannot score paper %d", key->paper_id, paper->paper_id);
+        return false;
+    }
+
+    ExamShuffle shuffle;
+    int in_paper_order[MAX_QUESTIONS_PER_PAPER];
+    exam_shuffle_derive(paper->paper_id, student_id, paper->num_questions, &shuffle);
+    exam_shuffle_answers_to_paper(&shuffle, answers, in_paper_order);
+
+    AnswerSheet sheet;
+    ExamScore result;
+    scoring_pack_answers(in_paper_order, paper->num_questions, &sheet);
+    scoring_score_batch(key, &sheet, 1, &result);
+    if (score) *score = result;
+
+    log_message(LOG_INFO, "Student %d submitted exam: %s (score %.2f of %d; %d right, %d wrong, %d skipped)",
+                student_id, paper->title, result.score, paper->total_marks,
+                result.right, result.wrong, result.unanswered);
     return true;
 }
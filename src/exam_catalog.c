@@ -0,0 +1,134 @@
+#include "../include/exam_catalog.h"
+#include "../include/logger.h"
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define CATALOG_MAGIC 0x54414345u  // "ECAT"
+#define CATALOG_VERSION 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t reserved;
+} CatalogHeader;
+
+static off_t entry_offset(long recno) {
+    return (off_t)sizeof(CatalogHeader) + (off_t)recno * (off_t)sizeof(PaperSummary);
+}
+
+static void make_summary(const PaperRecord *paper, long recno, PaperSummary *out) {
+    memset(out, 0, sizeof(*out));
+    out->paper_id = paper->paper_id;
+    memcpy(out->title, paper->title, sizeof(out->title));
+    memcpy(out->subject, paper->subject, sizeof(out->subject));
+    out->num_questions = paper->num_questions;
+    out->total_marks = paper->total_marks;
+    out->duration_minutes = paper->duration_minutes;
+    out->is_active = paper->is_active;
+    out->exam_date = paper->exam_date;
+    out->offset = (int64_t)recno * (int64_t)sizeof(PaperRecord);
+}
+
+// Every entry currently in the catalog, which may lag the data file. NULL
+// if there is no usable catalog.
+PaperSummary* exam_catalog_read(int *count) {
+    *count = 0;
+    int fd = open(EXAM_CATALOG_FILE, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    CatalogHeader hdr;
+    struct stat st;
+    PaperSummary *entries = NULL;
+    if (fstat(fd, &st) == 0 &&
+        pread(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) &&
+        hdr.magic == CATALOG_MAGIC && hdr.version == CATALOG_VERSION &&
+        hdr.entry_size == sizeof(PaperSummary)) {
+        size_t n = ((size_t)st.st_size - sizeof(hdr)) / sizeof(PaperSummary);
+        entries = malloc((n > 0 ? n : 1) * sizeof(PaperSummary));
+        size_t bytes = n * sizeof(PaperSummary);
+        if (entries && pread(fd, entries, bytes, entry_offset(0)) == (ssize_t)bytes) {
+            *count = (int)n;
+        } else {
+            free(entries);
+            entries = NULL;
+        }
+    }
+    close(fd);
+    return entries;
+}
+
+// Write a fresh catalog from the leading fields of every record
+static bool rebuild_catalog(int data_fd, size_t records) {
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", EXAM_CATALOG_FILE, (int)getpid());
+    FILE *out = fopen(tmp_path, "wb");
+    if (!out) {
+        log_message(LOG_ERROR, "Failed to create exam paper catalog");
+        return false;
+    }
+
+    CatalogHeader hdr = { CATALOG_MAGIC, CATALOG_VERSION, sizeof(PaperSummary), 0 };
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    size_t head = offsetof(PaperRecord, question_ids);
+    for (size_t i = 0; ok && i < records; i++) {
+        PaperRecord paper;
+        PaperSummary entry;
+        off_t at = (off_t)i * (off_t)sizeof(PaperRecord);
+        ok = pread(data_fd, &paper, head, at) == (ssize_t)head;
+        make_summary(&paper, (long)i, &entry);
+        ok = ok && fwrite(&entry, sizeof(entry), 1, out) == 1;
+    }
+
+    ok = (fclose(out) == 0) && ok;
+    if (!ok || rename(tmp_path, EXAM_CATALOG_FILE) != 0) {
+        log_message(LOG_ERROR, "Failed to write exam paper catalog");
+        remove(tmp_path);
+        return false;
+    }
+    log_message(LOG_INFO, "Rebuilt exam paper catalog (%zu papers)", records);
+    return true;
+}
+
+// The catalog, brought in step with the data file first. The caller must
+// hold a lock on data_fd that keeps writers out, such as a shared lock over
+// all records.
+PaperSummary* exam_catalog_load(int data_fd, int *count) {
+    *count = 0;
+    struct stat st;
+    if (fstat(data_fd, &st) != 0) return NULL;
+    size_t records = (size_t)st.st_size / sizeof(PaperRecord);
+
+    PaperSummary *entries = exam_catalog_read(count);
+    if (entries && (size_t)*count == records) return entries;
+
+    free(entries);
+    if (!rebuild_catalog(data_fd, records)) return NULL;
+    return exam_catalog_read(count);
+}
+
+// Record the paper just written at recno. Called under the record's lock.
+// A catalog that is missing or already behind is left for the next
+// exam_catalog_load() to rebuild.
+bool exam_catalog_put(long recno, const PaperRecord *paper) {
+    int fd = open(EXAM_CATALOG_FILE, O_RDWR);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && st.st_size >= entry_offset(recno);
+    if (ok) {
+        PaperSummary entry;
+        make_summary(paper, recno, &entry);
+        ok = pwrite(fd, &entry, sizeof(entry), entry_offset(recno)) == (ssize_t)sizeof(entry);
+        if (!ok) log_message(LOG_ERROR, "Failed to update exam paper catalog");
+    }
+    close(fd);
+    return ok;
+}
+
+// For compaction: record offsets are about to change
+void exam_catalog_remove(void) {
+    unlink(EXAM_CATALOG_FILE);
+}
@@ -0,0 +1,209 @@
+#include "../include/exam_schedule.h"
+#include "../include/file_lock.h"
+#include "../include/logger.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SCHEDULE_MAGIC 0x44484353u  // "SCHD"
+#define SCHEDULE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t records;    // Data file records the schedule covers
+    uint32_t count;      // Entries that follow
+    uint32_t reserved;
+} ScheduleHeader;
+
+// Local calendar day of when, counted from 1970-01-01
+int32_t exam_schedule_day(time_t when) {
+    struct tm tm;
+    if (!localtime_r(&when, &tm)) return 0;
+
+    // Days from the civil date, proleptic Gregorian
+    int y = tm.tm_year + 1900 - (tm.tm_mon < 2);
+    int m = tm.tm_mon + 1;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + tm.tm_mday - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const ScheduleEntry *x = a, *y = b;
+    if (x->day != y->day) return (x->day > y->day) - (x->day < y->day);
+    return (x->paper_id > y->paper_id) - (x->paper_id < y->paper_id);
+}
+
+// The entries of an open schedule file, with room for spare more. NULL if
+// the file is not a usable schedule.
+static ScheduleEntry* read_schedule(int fd, ScheduleHeader *hdr, size_t spare) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        pread(fd, hdr, sizeof(*hdr), 0) != (ssize_t)sizeof(*hdr) ||
+        hdr->magic != SCHEDULE_MAGIC || hdr->version != SCHEDULE_VERSION ||
+        (off_t)(sizeof(*hdr) + hdr->count * sizeof(ScheduleEntry)) != st.st_size) {
+        return NULL;
+    }
+
+    ScheduleEntry *entries = malloc((hdr->count + spare + 1) * sizeof(ScheduleEntry));
+    size_t bytes = hdr->count * sizeof(ScheduleEntry);
+    if (entries && pread(fd, entries, bytes, sizeof(*hdr)) != (ssize_t)bytes) {
+        free(entries);
+        entries = NULL;
+    }
+    return entries;
+}
+
+// Replace the schedule with a new file, so readers never see it half
+// written
+static bool write_schedule(ScheduleHeader *hdr, const ScheduleEntry *entries) {
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", EXAM_SCHEDULE_FILE, (int)getpid());
+    FILE *out = fopen(tmp_path, "wb");
+    if (!out) {
+        log_message(LOG_ERROR, "Failed to create exam schedule");
+        return false;
+    }
+
+    hdr->magic = SCHEDULE_MAGIC;
+    hdr->version = SCHEDULE_VERSION;
+    hdr->reserved = 0;
+    bool ok = fwrite(hdr, sizeof(*hdr), 1, out) == 1 &&
+              (hdr->count == 0 || fwrite(entries, sizeof(ScheduleEntry), hdr->count, out) == hdr->count);
+    ok = (fclose(out) == 0) && ok;
+    if (!ok || rename(tmp_path, EXAM_SCHEDULE_FILE) != 0) {
+        log_message(LOG_ERROR, "Failed to write exam schedule");
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+static bool rebuild_schedule(const PaperSummary *papers, int count) {
+    ScheduleEntry *entries = malloc((count > 0 ? count : 1) * sizeof(ScheduleEntry));
+    if (!entries) return false;
+
+    ScheduleHeader hdr = { 0, 0, (uint64_t)count, 0, 0 };
+    for (int i = 0; i < count; i++) {
+        if (!papers[i].is_active || papers[i].exam_date <= 0) continue;
+        ScheduleEntry *e = &entries[hdr.count++];
+        e->day = exam_schedule_day((time_t)papers[i].exam_date);
+        e->paper_id = papers[i].paper_id;
+        e->offset = papers[i].offset;
+    }
+    qsort(entries, hdr.count, sizeof(ScheduleEntry), compare_entries);
+
+    bool ok = write_schedule(&hdr, entries);
+    free(entries);
+    if (ok) log_message(LOG_INFO, "Rebuilt exam schedule (%u dated papers)", hdr.count);
+    return ok;
+}
+
+// The schedule, if it covers exactly the given number of data records
+static ScheduleEntry* read_current(uint64_t records, ScheduleHeader *hdr) {
+    int fd = open(EXAM_SCHEDULE_FILE, O_RDONLY);
+    if (fd < 0) return NULL;
+    ScheduleEntry *entries = read_schedule(fd, hdr, 0);
+    close(fd);
+    if (entries && hdr->records != records) {
+        free(entries);
+        entries = NULL;
+    }
+    return entries;
+}
+
+// First entry on or after day
+static uint32_t lower_bound(const ScheduleEntry *entries, uint32_t count, int32_t day) {
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].day < day) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Entries for first_day through last_day, in date order, with the schedule
+// brought in step with the data file first. The caller must keep record
+// writers out, as for exam_catalog_load().
+ScheduleEntry* exam_schedule_load(int data_fd, int32_t first_day, int32_t last_day, int *count) {
+    *count = 0;
+    struct stat st;
+    if (fstat(data_fd, &st) != 0) return NULL;
+    uint64_t records = (uint64_t)st.st_size / sizeof(PaperRecord);
+
+    ScheduleHeader hdr;
+    ScheduleEntry *entries = read_current(records, &hdr);
+    if (!entries) {
+        int papers = 0;
+        PaperSummary *catalog = exam_catalog_load(data_fd, &papers);
+        bool ok = catalog && rebuild_schedule(catalog, papers);
+        free(catalog);
+        entries = ok ? read_current(records, &hdr) : NULL;
+        if (!entries) return NULL;
+    }
+
+    uint32_t first = lower_bound(entries, hdr.count, first_day);
+    uint32_t end = lower_bound(entries, hdr.count, last_day + 1);
+    if (end > first) memmove(entries, entries + first, (end - first) * sizeof(ScheduleEntry));
+    *count = end > first ? (int)(end - first) : 0;
+    return entries;
+}
+
+// Record the paper just written at recno. Called under the record's lock.
+// A schedule that is missing or already behind is left for the next
+// exam_schedule_load() to rebuild.
+bool exam_schedule_put(long recno, const PaperRecord *paper) {
+    for (;;) {
+        int fd = open(EXAM_SCHEDULE_FILE, O_RDWR);
+        if (fd < 0) return false;
+        if (!file_lock(fd, 0, FILE_LOCK_WHOLE, FILE_LOCK_EXCLUSIVE)) {
+            close(fd);
+            return false;
+        }
+        // Another writer may have replaced it while we waited
+        if (!file_is_current(fd, EXAM_SCHEDULE_FILE)) {
+            close(fd);
+            continue;
+        }
+
+        ScheduleHeader hdr;
+        ScheduleEntry *entries = read_schedule(fd, &hdr, 1);
+        bool ok = entries && hdr.records >= (uint64_t)recno;
+        if (ok) {
+            // Drop the paper's old entry, then insert its new one in order
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < hdr.count; i++) {
+                if (entries[i].paper_id != paper->paper_id) entries[kept++] = entries[i];
+            }
+            hdr.count = kept;
+            if (paper->is_active && paper->exam_date > 0) {
+                ScheduleEntry e = { exam_schedule_day((time_t)paper->exam_date), paper->paper_id,
+                                    (int64_t)recno * (int64_t)sizeof(PaperRecord) };
+                uint32_t at = hdr.count;
+                while (at > 0 && compare_entries(&entries[at - 1], &e) > 0) {
+                    entries[at] = entries[at - 1];
+                    at--;
+                }
+                entries[at] = e;
+                hdr.count++;
+            }
+            if ((uint64_t)recno >= hdr.records) hdr.records = (uint64_t)recno + 1;
+            ok = write_schedule(&hdr, entries);
+        }
+        free(entries);
+        close(fd);
+        return ok;
+    }
+}
+
+// For compaction: record offsets are about to change
+void exam_schedule_remove(void) {
+    unlink(EXAM_SCHEDULE_FILE);
+}
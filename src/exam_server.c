@@ -0,0 +1,752 @@
+#define _GNU_SOURCE  // accept4
+#include "../include/exam_server.h"
+#include "../include/exam.h"
+#include "../include/student.h"
+#include "../include/exam_shuffle.h"
+#include "../include/scoring.h"
+#include "../include/answer_journal.h"
+#include "../include/timer_wheel.h"
+#include "../include/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define SERVER_LINE_MAX 64            // Longest request line
+#define SERVER_REPLY_MAX (MAX_QUESTION_TEXT + 4 * MAX_OPTION_LENGTH + 64)
+#define SERVER_OUTPUT_MAX (1 << 20)   // Unsent replies before a client is dropped
+#define SERVER_READ_BUFFER 16384
+#define SERVER_MAX_EVENTS 256
+#define SERVER_MAX_PAPERS 64
+#define SERVER_SESSION_BUCKETS 16384  // Power of two
+#define SERVER_TICK_MS 1000
+#define SERVER_BACKLOG 1024
+
+// Candidates are told when this many seconds are left
+static const int warning_seconds[] = { 600, 300, 60 };
+#define SERVER_WARNINGS ((int)(sizeof(warning_seconds) / sizeof(warning_seconds[0])))
+
+typedef struct {
+    int paper_id;
+    ExamPaper paper;          // Read-only once loaded
+    AnswerKey key;
+} ServedPaper;
+
+typedef struct Session {
+    int id;
+    int student_id;
+    const ServedPaper *served;
+    ExamShuffle shuffle;
+    int8_t answers[MAX_QUESTIONS_PER_PAPER];  // Slot chosen at each shown position, -1 if none
+    bool submitted;
+    ExamScore score;
+    int64_t started_ms;
+    int64_t deadline;         // Unix time the exam ends, 0 if untimed
+    int next_warning;         // Index into warning_seconds
+    TimerEntry deadline_timer;
+    TimerEntry warning_timer;
+    struct Connection *terminal;  // Connection sitting the exam, if any
+    struct Session *next;     // Bucket chain
+} Session;
+
+typedef struct Connection {
+    int fd;
+    Session *session;
+    char line[SERVER_LINE_MAX];
+    size_t line_len;
+    bool overlong;
+    char *out;                // Replies not yet written
+    size_t out_len, out_sent, out_cap;
+    bool want_write;          // EPOLLOUT registered
+    bool awaiting_sync;       // out waits for the answer journal
+    size_t held_from;         // Where in out the replies waiting on it begin
+    bool closing;             // Close once out is written
+    struct Connection *prev, *next;
+} Connection;
+
+typedef struct {
+    int epoll_fd;
+    int listen_fd;
+    ServedPaper *papers[SERVER_MAX_PAPERS];
+    int paper_count;
+    Connection *open_connections;
+    Session *buckets[SERVER_SESSION_BUCKETS];
+    int next_session_id;
+    TimerWheel timers;        // Ticks are seconds of Unix time
+    size_t connections, sessions, submitted, expired, requests;
+    size_t last_requests;     // requests at the previous report
+    int64_t last_report_ms;
+} ExamServer;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Replies are single lines, so the paper's text must not break them
+static void flatten(char *text) {
+    for (; *text; text++) {
+        if (*text == '\t' || *text == '\n' || *text == '\r') *text = ' ';
+    }
+}
+
+// The shared copy of paper_id, loaded on first use. NULL if there is no
+// such active paper.
+static const ServedPaper* serve_paper(ExamServer *server, int paper_id) {
+    for (int i = 0; i < server->paper_count; i++) {
+        if (server->papers[i]->paper_id == paper_id) return server->papers[i];
+    }
+    if (server->paper_count == SERVER_MAX_PAPERS) {
+        log_message(LOG_WARNING, "Exam server is already serving %d papers", SERVER_MAX_PAPERS);
+        return NULL;
+    }
+
+    ServedPaper *served = malloc(sizeof(ServedPaper));
+    if (!served) return NULL;
+    if (!load_exam_paper(paper_id, &served->paper) || !served->paper.is_active ||
+        served->paper.num_questions == 0 ||
+        !scoring_compile_key(&served->paper, scoring_negative_fraction(), &served->key)) {
+        free(served);
+        return NULL;
+    }
+
+    ExamPaper *paper = &served->paper;
+    served->paper_id = paper_id;
+    for (int q = 0; q < paper->num_questions; q++) {
+        flatten(paper->questions[q].text);
+        for (int j = 0; j < SHUFFLE_OPTIONS; j++) flatten(paper->questions[q].options[j].text);
+    }
+    server->papers[server->paper_count++] = served;
+    log_message(LOG_INFO, "Exam server loaded paper %d: %s (%d questions)",
+                paper_id, paper->title, paper->num_questions);
+    return served;
+}
+
+static Session** session_bucket(ExamServer *server, int student_id, int paper_id) {
+    uint32_t h = (uint32_t)student_id * 0x9e3779b1u ^ (uint32_t)paper_id * 0x85ebca6bu;
+    return &server->buckets[(h ^ (h >> 15)) & (SERVER_SESSION_BUCKETS - 1)];
+}
+
+static Session* find_session(ExamServer *server, int student_id, const ServedPaper *served) {
+    for (Session *s = *session_bucket(server, student_id, served->paper_id); s; s = s->next) {
+        if (s->student_id == student_id && s->served == served) return s;
+    }
+    return NULL;
+}
+
+static Session* add_session(ExamServer *server, int student_id, const ServedPaper *served, int64_t started_ms) {
+    Session *s = malloc(sizeof(Session));
+    if (!s) return NULL;
+    s->id = ++server->next_session_id;
+    s->student_id = student_id;
+    s->served = served;
+    exam_shuffle_derive(served->paper_id, student_id, served->paper.num_questions, &s->shuffle);
+    memset(s->answers, -1, sizeof(s->answers));
+    s->submitted = false;
+    memset(&s->score, 0, sizeof(s->score));
+    s->started_ms = started_ms;
+    s->deadline = 0;
+    s->next_warning = 0;
+    timer_init(&s->deadline_timer, NULL);
+    timer_init(&s->warning_timer, NULL);
+    s->terminal = NULL;
+
+    Session **bucket = session_bucket(server, student_id, served->paper_id);
+    s->next = *bucket;
+    *bucket = s;
+    server->sessions++;
+    return s;
+}
+
+// Rebuild a session from the journal at startup
+static bool replay_event(const AnswerEvent *event, void *arg) {
+    ExamServer *server = arg;
+    const ServedPaper *served = serve_paper(server, event->paper_id);
+    if (!served) return false;
+    Session *s = find_session(server, event->student_id, served);
+
+    if (event->kind == ANSWER_EVENT_START) {
+        return s || add_session(server, event->student_id, served, event->time_ms);
+    }
+    if (!s || s->submitted) return false;
+    if (event->kind == ANSWER_EVENT_ANSWER) {
+        if (event->question >= served->paper.num_questions || event->choice < -1 ||
+            event->choice >= SHUFFLE_OPTIONS) {
+            return false;
+        }
+        s->answers[event->question] = event->choice;
+        return true;
+    }
+    if (event->kind == ANSWER_EVENT_SUBMIT) {
+        // Scored and logged when it happened
+        s->submitted = true;
+        server->submitted++;
+        return true;
+    }
+    return false;
+}
+
+static void reply(Connection *c, const char *format, ...) {
+    char buffer[SERVER_REPLY_MAX];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer) - 1, format, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t)n > sizeof(buffer) - 2) n = (int)sizeof(buffer) - 2;
+    buffer[n++] = '\n';
+
+    if (c->out_len + (size_t)n > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap : 1024;
+        while (cap < c->out_len + (size_t)n) cap *= 2;
+        char *grown = cap <= SERVER_OUTPUT_MAX ? realloc(c->out, cap) : NULL;
+        if (!grown) {
+            // A client that stops reading loses its connection, not the server's memory
+            c->closing = true;
+            c->out_len = c->out_sent = 0;
+            return;
+        }
+        c->out = grown;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, buffer, (size_t)n);
+    c->out_len += (size_t)n;
+}
+
+// Hold c's replies from here on until the journal is synced
+static void hold_replies(Connection *c) {
+    if (c->awaiting_sync) return;
+    c->awaiting_sync = true;
+    c->held_from = c->out_len;
+}
+
+// Journal a change to a session before it is made; the reply to it waits
+// for the journal to reach disk
+static bool journal_change(Connection *c, int kind, int student_id, int paper_id, int question, int choice) {
+    AnswerEvent event = { now_ms(), student_id, paper_id, (uint8_t)kind, (uint8_t)question,
+                          (int8_t)choice, 0, 0 };
+    if (!answer_journal_append(&event)) {
+        if (c) reply(c, "ERR could not save");
+        return false;
+    }
+    if (c) hold_replies(c);
+    return true;
+}
+
+static void send_question(Connection *c, const Session *s, int n) {
+    int q = s->shuffle.question_order[n - 1];
+    const Question *question = &s->served->paper.questions[q];
+    const uint8_t *slots = s->shuffle.option_order[q];
+    reply(c, "QUESTION %d %d %s\t%s\t%s\t%s\t%s", n, question->marks, question->text,
+          question->options[slots[0]].text, question->options[slots[1]].text,
+          question->options[slots[2]].text, question->options[slots[3]].text);
+}
+
+static void submit_session(ExamServer *server, Session *s) {
+    const ExamPaper *paper = &s->served->paper;
+    int shown[MAX_QUESTIONS_PER_PAPER];
+    for (int i = 0; i < paper->num_questions; i++) shown[i] = s->answers[i];
+    if (submit_exam_with_key(s->student_id, paper, &s->served->key, shown, &s->score)) {
+        s->submitted = true;
+        server->submitted++;
+        timer_wheel_cancel(&server->timers, &s->deadline_timer);
+        timer_wheel_cancel(&server->timers, &s->warning_timer);
+    }
+}
+
+#define SESSION_OF(timer, field) ((Session*)((char*)(timer) - offsetof(Session, field)))
+
+static void arm_warning(ExamServer *server, Session *s) {
+    while (s->next_warning < SERVER_WARNINGS) {
+        int64_t at = s->deadline - warning_seconds[s->next_warning];
+        if (at > (int64_t)server->timers.now) {
+            timer_wheel_add(&server->timers, &s->warning_timer, (uint64_t)at);
+            return;
+        }
+        s->next_warning++;
+    }
+}
+
+static void fire_warning(TimerEntry *timer, void *arg) {
+    ExamServer *server = arg;
+    Session *s = SESSION_OF(timer, warning_timer);
+    if (s->terminal) reply(s->terminal, "TIME %d", warning_seconds[s->next_warning]);
+    s->next_warning++;
+    arm_warning(server, s);
+}
+
+// Time is up: submit the answers as they stand
+static void fire_deadline(TimerEntry *timer, void *arg) {
+    ExamServer *server = arg;
+    Session *s = SESSION_OF(timer, deadline_timer);
+    if (!journal_change(NULL, ANSWER_EVENT_SUBMIT, s->student_id, s->served->paper_id, 0, -1)) {
+        // Try again on the next tick rather than lose the submission
+        timer_wheel_add(&server->timers, &s->deadline_timer, server->timers.now + 1);
+        return;
+    }
+    // TIME 0 waits for the submission to reach disk, like any reply
+    if (s->terminal) hold_replies(s->terminal);
+
+    log_message(LOG_INFO, "Exam time is up for student %d: %s", s->student_id, s->served->paper.title);
+    submit_session(server, s);
+    server->expired++;
+    if (s->terminal) reply(s->terminal, "TIME 0");
+}
+
+// Enforce the paper's duration, counted from when the session started
+static void arm_timers(ExamServer *server, Session *s) {
+    int minutes = s->served->paper.duration_minutes;
+    if (minutes <= 0 || s->submitted) return;
+
+    s->deadline = s->started_ms / 1000 + (int64_t)minutes * 60;
+    s->next_warning = 0;
+    s->deadline_timer.fire = fire_deadline;
+    s->warning_timer.fire = fire_warning;
+    timer_wheel_add(&server->timers, &s->deadline_timer, (uint64_t)s->deadline);
+    arm_warning(server, s);
+}
+
+static void handle_request(ExamServer *server, Connection *c, char *line) {
+    server->requests++;
+    char *save = NULL;
+    char *command = strtok_r(line, " ", &save);
+    char *arg1 = strtok_r(NULL, " ", &save);
+    char *arg2 = strtok_r(NULL, " ", &save);
+    if (!command) {
+        reply(c, "ERR empty request");
+        return;
+    }
+
+    Session *s = c->session;
+    if (strcmp(command, "START") == 0) {
+        int student_id = arg1 ? atoi(arg1) : 0;
+        int paper_id = arg2 ? atoi(arg2) : 0;
+        if (s) {
+            reply(c, "ERR exam already started");
+            return;
+        }
+        if (student_id <= 0 || paper_id <= 0) {
+            reply(c, "ERR usage: START <student_id> <paper_id>");
+            return;
+        }
+        const ServedPaper *served = serve_paper(server, paper_id);
+        if (!served) {
+            reply(c, "ERR no such paper");
+            return;
+        }
+        s = find_session(server, student_id, served);
+        if (!s) {
+            const Student *student = get_student(student_id);
+            if (!student || !student->is_active) {
+                reply(c, "ERR no such student");
+                return;
+            }
+            if (!journal_change(c, ANSWER_EVENT_START, student_id, paper_id, 0, -1)) return;
+            s = add_session(server, student_id, served, now_ms());
+            if (s) {
+                start_exam(student_id, &served->paper);
+                arm_timers(server, s);
+            }
+        }
+        if (!s) {
+            reply(c, "ERR out of memory");
+        } else if (s->submitted) {
+            reply(c, "ERR exam already submitted");
+        } else {
+            // A terminal that takes over leaves the old one without an exam
+            if (s->terminal) s->terminal->session = NULL;
+            s->terminal = c;
+            c->session = s;
+            long long left = -1;
+            if (s->deadline) left = s->deadline > now_ms() / 1000 ? s->deadline - now_ms() / 1000 : 0;
+            reply(c, "OK %d %d %d %lld", s->id, served->paper.num_questions,
+                  served->paper.duration_minutes, left);
+        }
+        return;
+    }
+
+    if (strcmp(command, "QUIT") == 0) {
+        reply(c, "BYE");
+        c->closing = true;
+        return;
+    }
+
+    bool is_question = strcmp(command, "QUESTION") == 0;
+    bool is_answer = strcmp(command, "ANSWER") == 0;
+    bool is_submit = strcmp(command, "SUBMIT") == 0;
+    if (!is_question && !is_answer && !is_submit) {
+        reply(c, "ERR unknown request");
+        return;
+    }
+    if (!s) {
+        reply(c, "ERR no exam started");
+        return;
+    }
+    if (s->submitted) {
+        // Submitted when its time ran out
+        c->session = NULL;
+        s->terminal = NULL;
+        reply(c, "ERR time is up");
+        return;
+    }
+
+    if (is_submit) {
+        if (!journal_change(c, ANSWER_EVENT_SUBMIT, s->student_id, s->served->paper_id, 0, -1)) return;
+        submit_session(server, s);
+        if (!s->submitted) {
+            reply(c, "ERR scoring failed");
+            return;
+        }
+        c->session = NULL;
+        s->terminal = NULL;
+        reply(c, "SCORE %.2f %d %d %d", s->score.score, s->score.right, s->score.wrong, s->score.unanswered);
+        return;
+    }
+
+    int n = arg1 ? atoi(arg1) : 0;
+    if (n < 1 || n > s->served->paper.num_questions) {
+        reply(c, "ERR no such question");
+        return;
+    }
+    if (is_question) {
+        send_question(c, s, n);
+        return;
+    }
+
+    if (!arg2 || arg2[1] != '\0' || !(arg2[0] == '-' || (arg2[0] >= 'A' && arg2[0] < 'A' + SHUFFLE_OPTIONS))) {
+        reply(c, "ERR answer must be A-D or -");
+        return;
+    }
+    int choice = arg2[0] == '-' ? -1 : arg2[0] - 'A';
+    if (s->answers[n - 1] != choice) {
+        if (!journal_change(c, ANSWER_EVENT_ANSWER, s->student_id, s->served->paper_id, n - 1, choice)) return;
+        s->answers[n - 1] = (int8_t)choice;
+    }
+    reply(c, "OK");
+}
+
+// Split newly read bytes into request lines; a partial line is kept for
+// the next read
+static void process_input(ExamServer *server, Connection *c, const char *data, size_t len) {
+    for (size_t i = 0; i < len && !c->closing; i++) {
+        char ch = data[i];
+        if (ch == '\n') {
+            if (c->overlong) {
+                server->requests++;
+                reply(c, "ERR request too long");
+            } else {
+                if (c->line_len > 0 && c->line[c->line_len - 1] == '\r') c->line_len--;
+                c->line[c->line_len] = '\0';
+                handle_request(server, c, c->line);
+            }
+            c->line_len = 0;
+            c->overlong = false;
+        } else if (c->line_len + 1 < SERVER_LINE_MAX) {
+            c->line[c->line_len++] = ch;
+        } else {
+            c->overlong = true;
+        }
+    }
+}
+
+static void close_connection(ExamServer *server, Connection *c) {
+    if (c->session && c->session->terminal == c) c->session->terminal = NULL;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    if (c->prev) c->prev->next = c->next;
+    else server->open_connections = c->next;
+    if (c->next) c->next->prev = c->prev;
+    free(c->out);
+    free(c);
+    server->connections--;
+}
+
+// Write what the socket takes now and watch for room for the rest. False
+// if the connection is finished with.
+static bool flush_output(ExamServer *server, Connection *c) {
+    if (c->awaiting_sync) return true;
+    while (c->out_sent < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->out_sent += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    if (c->out_sent == c->out_len) {
+        c->out_len = c->out_sent = 0;
+        if (c->closing) return false;
+    }
+
+    bool want_write = c->out_len > 0;
+    if (want_write != c->want_write) {
+        struct epoll_event ev = { EPOLLIN | (want_write ? EPOLLOUT : 0), { .ptr = c } };
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->want_write = want_write;
+    }
+    return true;
+}
+
+// Sync the answer journal and send the replies that waited on it. If the
+// sync fails, those replies are taken back and the terminal is told its
+// changes were not saved and disconnected, so it never shows an answer as
+// saved that is not on disk.
+static void sync_answers(ExamServer *server) {
+    bool synced = answer_journal_sync();
+    Connection *c = server->open_connections;
+    while (c) {
+        Connection *next = c->next;
+        if (c->awaiting_sync) {
+            c->awaiting_sync = false;
+            if (!synced) {
+                if (c->held_from < c->out_len) c->out_len = c->held_from;
+                reply(c, "ERR could not save");
+                c->closing = true;
+            }
+            if (!flush_output(server, c)) close_connection(server, c);
+        }
+        c = next;
+    }
+}
+
+// Send what timers queued for terminals that had no request in flight
+static void flush_notices(ExamServer *server) {
+    Connection *c = server->open_connections;
+    while (c) {
+        Connection *next = c->next;
+        if (c->out_len > c->out_sent && !c->want_write && !flush_output(server, c)) {
+            close_connection(server, c);
+        }
+        c = next;
+    }
+}
+
+static void accept_connections(ExamServer *server) {
+    for (;;) {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_message(LOG_WARNING, "Exam server failed to accept a connection: %s", strerror(errno));
+            }
+            return;
+        }
+
+        Connection *c = calloc(1, sizeof(Connection));
+        struct epoll_event ev = { EPOLLIN, { .ptr = c } };
+        if (!c || epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->next = server->open_connections;
+        if (c->next) c->next->prev = c;
+        server->open_connections = c;
+        server->connections++;
+    }
+}
+
+static void serve_connection(ExamServer *server, Connection *c, uint32_t events, char *buffer) {
+    bool open = true;
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        ssize_t n = read(c->fd, buffer, SERVER_READ_BUFFER);
+        if (n > 0) {
+            process_input(server, c, buffer, (size_t)n);
+        } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            open = false;
+        }
+    }
+    if (open) open = flush_output(server, c);
+    if (!open) close_connection(server, c);
+}
+
+// A listening socket for a path with a '/' in it, or a port on localhost
+static int open_listener(const char *address) {
+    int fd;
+    if (strchr(address, '/')) {
+        struct sockaddr_un sun;
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        if (strlen(address) >= sizeof(sun.sun_path)) return -1;
+        strcpy(sun.sun_path, address);
+
+        // A socket left behind by an earlier run
+        struct stat st;
+        if (stat(address, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(address);
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && bind(fd, (struct sockaddr*)&sun, sizeof(sun)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        char *end;
+        long port = strtol(address, &end, 10);
+        if (*address == '\0' || *end != '\0' || port <= 0 || port > 65535) return -1;
+
+        struct sockaddr_in sin;
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons((uint16_t)port);
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (fd >= 0 && bind(fd, (struct sockaddr*)&sin, sizeof(sin)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0 && listen(fd, SERVER_BACKLOG) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// One descriptor per terminal: take all the process is allowed
+static void raise_descriptor_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void report(ExamServer *server, int64_t now) {
+    double seconds = (double)(now - server->last_report_ms) / 1000.0;
+    double rate = seconds > 0 ? (double)(server->requests - server->last_requests) / seconds : 0;
+    printf("\n\t\t%zu connections  %zu sessions  %zu submitted (%zu on time-out)  %zu requests (%.0f/s)",
+           server->connections, server->sessions, server->submitted, server->expired, server->requests, rate);
+    fflush(stdout);
+    server->last_requests = server->requests;
+    server->last_report_ms = now;
+}
+
+// Serve candidates on address until SIGINT or SIGTERM. Exams not submitted
+// by then resume from the answer journal when the server next starts.
+bool run_exam_server(const char *address) {
+    ExamServer *server = calloc(1, sizeof(ExamServer));
+    struct epoll_event *events = malloc(SERVER_MAX_EVENTS * sizeof(struct epoll_event));
+    char *buffer = malloc(SERVER_READ_BUFFER);
+    if (!server || !events || !buffer) {
+        free(server);
+        free(events);
+        free(buffer);
+        log_message(LOG_ERROR, "Memory allocation failed for exam server");
+        return false;
+    }
+
+    raise_descriptor_limit();
+    server->listen_fd = address ? open_listener(address) : -1;
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { EPOLLIN, { .ptr = NULL } };
+    bool ok = server->listen_fd >= 0 && server->epoll_fd >= 0 &&
+              epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &ev) == 0;
+    if (!ok) {
+        log_message(LOG_ERROR, "Failed to start exam server on %s: %s",
+                    address ? address : "(no address)", strerror(errno));
+    }
+
+    // Pick up the sessions of a server that stopped or crashed mid-exam
+    SystemConfig config = load_system_config();
+    answer_journal_set_sync_interval(config.answer_sync_ms);
+    timer_wheel_init(&server->timers, (uint64_t)(now_ms() / 1000));
+    ok = ok && answer_journal_open(replay_event, server);
+
+    // Deadlines that passed while the server was down fire on the first tick
+    for (int b = 0; ok && b < SERVER_SESSION_BUCKETS; b++) {
+        for (Session *s = server->buckets[b]; s; s = s->next) arm_timers(server, s);
+    }
+
+    struct sigaction sa, old_int, old_term, old_pipe;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = request_stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, &old_pipe);
+    stop_requested = 0;
+
+    server->last_report_ms = now_ms();
+    if (ok) {
+        log_message(LOG_INFO, "Exam server started on %s (%zu sessions, %zu submitted)",
+                    address, server->sessions, server->submitted);
+    }
+
+    while (ok && !stop_requested) {
+        int wait = answer_journal_sync_wait(now_ms());
+        if (wait < 0 || wait > SERVER_TICK_MS) wait = SERVER_TICK_MS;
+        int ready = epoll_wait(server->epoll_fd, events, SERVER_MAX_EVENTS, wait);
+        if (ready < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.ptr) {
+                serve_connection(server, events[i].data.ptr, events[i].events, buffer);
+            } else {
+                accept_connections(server);
+            }
+        }
+
+        int64_t now = now_ms();
+        if (timer_wheel_advance(&server->timers, (uint64_t)(now / 1000), server) > 0) flush_notices(server);
+        if (answer_journal_sync_wait(now) == 0) sync_answers(server);
+        if (now - server->last_report_ms >= SERVER_TICK_MS) {
+            if (server->requests != server->last_requests) report(server, now);
+            else server->last_report_ms = now;
+        }
+    }
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    sigaction(SIGPIPE, &old_pipe, NULL);
+    if (ok) {
+        report(server, now_ms());
+        log_message(LOG_INFO, "Exam server stopped: %zu sessions, %zu submitted (%zu on time-out), %zu requests",
+                    server->sessions, server->submitted, server->expired, server->requests);
+    }
+
+    sync_answers(server);
+    answer_journal_close();
+    while (server->open_connections) close_connection(server, server->open_connections);
+    if (server->epoll_fd >= 0) close(server->epoll_fd);
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        if (strchr(address, '/')) unlink(address);
+    }
+    for (int b = 0; b < SERVER_SESSION_BUCKETS; b++) {
+        while (server->buckets[b]) {
+            Session *s = server->buckets[b];
+            server->buckets[b] = s->next;
+            free(s);
+        }
+    }
+    for (int i = 0; i < server->paper_count; i++) free(server->papers[i]);
+    free(server);
+    free(events);
+    free(buffer);
+    return ok;
+}
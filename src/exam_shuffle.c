@@ -0,0 +1,97 @@
+#include "../include/exam_shuffle.h"
+#include <stddef.h>
+
+#define SHUFFLE_SALT 0x45584d5348554646ull  // "EXMSHUFF"
+
+typedef struct {
+    uint64_t s[4];
+} ShuffleRng;
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256**
+static uint64_t next_random(ShuffleRng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// Uniform in [0, bound), by multiply-shift with rejection of the biased
+// low range
+static uint32_t random_below(ShuffleRng *rng, uint32_t bound) {
+    uint64_t m = (next_random(rng) >> 32) * bound;
+    if ((uint32_t)m < bound) {
+        uint32_t threshold = -bound % bound;
+        while ((uint32_t)m < threshold) m = (next_random(rng) >> 32) * bound;
+    }
+    return (uint32_t)(m >> 32);
+}
+
+static void shuffle_bytes(ShuffleRng *rng, uint8_t *items, int count) {
+    for (int i = count - 1; i > 0; i--) {
+        int j = (int)random_below(rng, (uint32_t)i + 1);
+        uint8_t tmp = items[i];
+        items[i] = items[j];
+        items[j] = tmp;
+    }
+}
+
+void exam_shuffle_derive(int paper_id, int student_id, int num_questions, ExamShuffle *shuffle) {
+    if (num_questions < 0) num_questions = 0;
+    if (num_questions > MAX_QUESTIONS_PER_PAPER) num_questions = MAX_QUESTIONS_PER_PAPER;
+
+    uint64_t seed = (((uint64_t)(uint32_t)paper_id << 32) | (uint32_t)student_id) ^ SHUFFLE_SALT;
+    ShuffleRng rng;
+    for (int i = 0; i < 4; i++) rng.s[i] = splitmix64(&seed);
+
+    memset(shuffle, 0, sizeof(*shuffle));
+    shuffle->num_questions = num_questions;
+    for (int q = 0; q < num_questions; q++) shuffle->question_order[q] = (uint8_t)q;
+    shuffle_bytes(&rng, shuffle->question_order, num_questions);
+
+    for (int q = 0; q < num_questions; q++) {
+        for (int j = 0; j < SHUFFLE_OPTIONS; j++) shuffle->option_order[q][j] = (uint8_t)j;
+        shuffle_bytes(&rng, shuffle->option_order[q], SHUFFLE_OPTIONS);
+    }
+}
+
+// The paper as the candidate sees it, in a separate buffer. Questions keep
+// their question_id.
+void exam_shuffle_view(const ExamPaper *paper, const ExamShuffle *shuffle, ExamPaper *view) {
+    memcpy(view, paper, offsetof(ExamPaper, questions));
+    for (int i = 0; i < shuffle->num_questions; i++) {
+        int q = shuffle->question_order[i];
+        const Question *from = &paper->questions[q];
+        Question *to = &view->questions[i];
+        *to = *from;
+        for (int j = 0; j < SHUFFLE_OPTIONS; j++) {
+            to->options[j] = from->options[shuffle->option_order[q][j]];
+        }
+    }
+}
+
+// Map answers given on the candidate's view (shown[i] is the option slot
+// chosen at position i, -1 if skipped) back to paper order
+void exam_shuffle_answers_to_paper(const ExamShuffle *shuffle, const int *shown, int *answers) {
+    for (int i = 0; i < shuffle->num_questions; i++) {
+        int q = shuffle->question_order[i];
+        int slot = shown[i];
+        answers[q] = (slot >= 0 && slot < SHUFFLE_OPTIONS) ? shuffle->option_order[q][slot] : -1;
+    }
+}
@@ -0,0 +1,59 @@
+#define _GNU_SOURCE  // F_OFD_SETLKW
+#include "../include/file_lock.h"
+#include "../include/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef F_OFD_SETLKW
+static bool ofd_supported = true;
+#endif
+
+// Block until the range is locked (or unlocked, for F_UNLCK)
+static bool set_lock(int fd, short type, off_t start, off_t len) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = start;
+    fl.l_len = len;
+
+#ifdef F_OFD_SETLKW
+    if (ofd_supported) {
+        int rc;
+        while ((rc = fcntl(fd, F_OFD_SETLKW, &fl)) != 0 && errno == EINTR) {}
+        if (rc == 0) return true;
+        if (errno != EINVAL) return false;
+        // Kernel without OFD locks; fall back for good
+        ofd_supported = false;
+        log_message(LOG_WARNING, "OFD locks unavailable, using process-wide record locks");
+    }
+#endif
+    int rc;
+    while ((rc = fcntl(fd, F_SETLKW, &fl)) != 0 && errno == EINTR) {}
+    return rc == 0;
+}
+
+bool file_lock(int fd, off_t start, off_t len, FileLockMode mode) {
+    if (fd < 0) return false;
+    if (!set_lock(fd, mode == FILE_LOCK_EXCLUSIVE ? F_WRLCK : F_RDLCK, start, len)) {
+        log_message(LOG_ERROR, "Failed to lock file range %lld+%lld", (long long)start, (long long)len);
+        return false;
+    }
+    return true;
+}
+
+bool file_unlock(int fd, off_t start, off_t len) {
+    return fd >= 0 && set_lock(fd, F_UNLCK, start, len);
+}
+
+// Whether fd still refers to the file at path. A lock taken on a file that
+// has since been replaced (compaction renames a new one in) protects
+// nothing, so lockers check this and reopen.
+bool file_is_current(int fd, const char *path) {
+    struct stat st, fst;
+    return stat(path, &st) == 0 && fstat(fd, &fst) == 0 &&
+           st.st_ino == fst.st_ino && st.st_dev == fst.st_dev;
+}
@@ -2,10 +2,14 @@
 #include "../include/common.h"
 #include "../include/user.h"
 #include "../include/student.h"
+#include "../include/student_wal.h"
+#include "../include/student_cache.h"
+#include "../include/attendance.h"
+#include "../include/exam_server.h"
 #include "../include/exam.h"
 #include "../include/input_utils.h"
 
-int main() {
+int main(int argc, char *argv[]) {
     // Initialize system directories
     ensure_dir_exists("data");
     ensure_dir_exists("backups");
@@ -14,9 +18,30 @@ int main() {
     // Initialize logging system
     init_log_system();
     log_message(LOG_INFO, "Application started");
-    
+
     // Load system configuration
     SystemConfig config = load_system_config();
+    if (config.student_cache_kb > 0) {
+        student_cache_set_budget((size_t)config.student_cache_kb * 1024);
+    }
+    if (config.wal_commit_window_us != 0) {
+        student_wal_set_commit_window(config.wal_commit_window_us > 0 ? (unsigned)config.wal_commit_window_us : 0);
+    }
+
+    // Replay student changes that were journaled but not yet checkpointed
+    if (!student_wal_open()) {
+        log_message(LOG_ERROR, "Student journal recovery failed");
+    }
+
+    // Gate stations run check-in unattended: ems --checkin [fifo]
+    if (argc > 1 && strcmp(argv[1], "--checkin") == 0) {
+        return run_checkin_stream(argc > 2 ? argv[2] : NULL) ? 0 : 1;
+    }
+
+    // Exam halls serve candidates' terminals: ems --exam-server <socket path or port>
+    if (argc > 1 && strcmp(argv[1], "--exam-server") == 0) {
+        return run_exam_server(argc > 2 ? argv[2] : NULL) ? 0 : 1;
+    }
     
     // Check if this is first run by looking for user file
     if (!FILE_EXISTS(USER_FILE)) {
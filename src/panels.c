@@ -2,6 +2,7 @@
 #include "../include/user.h"
 #include "../include/student.h"
 #include "../include/exam.h"
+#include "../include/attendance.h"
 
 void show_main_menu(void) {
     print_header();
@@ -13,11 +14,16 @@ void show_main_menu(void) {
     printf("\n\t\tadd-student    | Register a new student");
     printf("\n\t\tlist-students  | View all students");
     printf("\n\t\tsearch-student | Search for a student");
+    printf("\n\t\tid-cards       | Generate student ID cards with QR codes");
+    printf("\n\t\tgate-checkin   | Check in candidates from a QR scanner feed");
+    printf("\n\t\texam-schedule  | Papers scheduled for the next two weeks");
     printf("\n\t\tstart-exam     | Begin your entrance exam (students only)");
     printf("\n\t\tview-results   | View your exam results");
     printf("\n\t\trankings       | See student rankings");
+    printf("\n\t\timport-csv     | Bulk import students from CSV");
     printf("\n\t\tbackup-csv     | Export data to CSV");
     printf("\n\t\tbackup-binary  | Create a binary backup");
+    printf("\n\t\tcompact        | Reclaim space held by deleted records");
     printf("\n\t\tgenerate-report| Generate exam report");
     printf("\n\t\tview-logs      | View system logs");
     printf("\n\t\tsystem-settings| Change system configuration");
@@ -50,13 +56,41 @@ void handle_menu_command(const char *cmd) {
         add_student(&new_student);
     }
     else if (strcmp(cmd, "list-students") == 0) {
-        // TODO: Implement list_students()
-        printf("\n\t\tListing students...");
+        list_students();
     }
     else if (strcmp(cmd, "search-student") == 0) {
         // TODO: Implement search functionality
         printf("\n\t\tSearching for student...");
     }
+    else if (strcmp(cmd, "id-cards") == 0) {
+        if (current_user.role != ROLE_ADMIN && current_user.role != ROLE_EXAMINER) {
+            printf("\n\t\tAccess denied. Staff privileges required.");
+            return;
+        }
+        char grade[10];
+        printf("\n\t\tGrade (blank for all active students): ");
+        safe_input(grade, sizeof(grade));
+        generate_id_cards(grade[0] ? grade : NULL);
+    }
+    else if (strcmp(cmd, "gate-checkin") == 0) {
+        if (current_user.role != ROLE_ADMIN && current_user.role != ROLE_EXAMINER) {
+            printf("\n\t\tAccess denied. Staff privileges required.");
+            return;
+        }
+        char path[256];
+        printf("\n\t\tScanner FIFO (blank for stdin, Ctrl-C to stop): ");
+        safe_input(path, sizeof(path));
+        if (!run_checkin_stream(path[0] ? path : NULL)) {
+            printf("\n\t\tCheck-in stream failed. See the system log for details.");
+        }
+    }
+    else if (strcmp(cmd, "exam-schedule") == 0) {
+        if (current_user.role != ROLE_ADMIN && current_user.role != ROLE_EXAMINER) {
+            printf("\n\t\tAccess denied. Staff privileges required.");
+            return;
+        }
+        list_scheduled_papers(time(NULL), 14);
+    }
     else if (strcmp(cmd, "start-exam") == 0) {
         if (current_user.role != ROLE_USER) {
             printf("\n\t\tAccess denied. Student access only.");
@@ -73,13 +107,31 @@ void handle_menu_command(const char *cmd) {
         // TODO: Implement show_rankings()
         printf("\n\t\tShowing rankings...");
     }
+    else if (strcmp(cmd, "import-csv") == 0) {
+        if (current_user.role != ROLE_ADMIN) {
+            printf("\n\t\tAccess denied. Admin privileges required.");
+            return;
+        }
+        char path[256];
+        printf("\n\t\tCSV file to import: ");
+        safe_input(path, sizeof(path));
+        if (!import_students_from_csv(path)) {
+            printf("\n\t\tImport failed. See the system log for details.");
+        }
+    }
     else if (strcmp(cmd, "backup-csv") == 0) {
         if (current_user.role != ROLE_ADMIN) {
             printf("\n\t\tAccess denied. Admin privileges required.");
             return;
         }
-        // TODO: Implement export_to_csv()
-        printf("\n\t\tExporting to CSV...");
+        char path[64];
+        time_t now = time(NULL);
+        strftime(path, sizeof(path), "backups/students_%Y%m%d_%H%M%S.csv", localtime(&now));
+        if (export_students_to_csv(path)) {
+            printf("\n\t\tStudents exported to %s", path);
+        } else {
+            printf("\n\t\tExport failed. See the system log for details.");
+        }
     }
     else if (strcmp(cmd, "backup-binary") == 0) {
         if (current_user.role != ROLE_ADMIN) {
@@ -89,6 +141,30 @@ void handle_menu_command(const char *cmd) {
         // TODO: Implement create_binary_backup()
         printf("\n\t\tCreating binary backup...");
     }
+    else if (strcmp(cmd, "compact") == 0) {
+        if (current_user.role != ROLE_ADMIN) {
+            printf("\n\t\tAccess denied. Admin privileges required.");
+            return;
+        }
+        SystemConfig config = load_system_config();
+        CompactionStats students = {0}, papers = {0};
+        bool ok = true;
+        if (!config.keep_inactive_students) {
+            ok = compact_students(config.compact_min_age_days, &students) && ok;
+        }
+        if (!config.keep_deleted_papers) {
+            ok = compact_exam_papers(&papers) && ok;
+        }
+        printf("\n\t\tStudents:    %ld record(s), %lld byte(s) reclaimed",
+               students.records_before - students.records_after,
+               students.bytes_before - students.bytes_after);
+        printf("\n\t\tExam papers: %ld record(s), %lld byte(s) reclaimed",
+               papers.records_before - papers.records_after,
+               papers.bytes_before - papers.bytes_after);
+        if (!ok) {
+            printf("\n\t\tCompaction incomplete. See the system log for details.");
+        }
+    }
     else if (strcmp(cmd, "generate-report") == 0) {
         if (current_user.role != ROLE_ADMIN && current_user.role != ROLE_EXAMINER) {
             printf("\n\t\tAccess denied. Staff privileges required.");
@@ -0,0 +1,434 @@
+#include "../include/qr.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Level M tables, indexed by version
+static const int ecc_per_block[QR_MAX_VERSION + 1] = { 0, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26 };
+static const int block_count[QR_MAX_VERSION + 1] = { 0, 1, 1, 1, 2, 2, 4, 4, 4, 5, 5 };
+
+#define QR_MAX_CODEWORDS 346   // Raw codewords in a version 10 symbol
+#define QR_MAX_ECC 30
+#define FORMAT_BITS_LEVEL_M 0
+
+typedef struct {
+    QrCode *qr;
+    uint8_t is_function[QR_MAX_SIZE][QR_MAX_SIZE];
+} Builder;
+
+// Data and error correction modules in a symbol, excluding function patterns
+static int raw_module_count(int version) {
+    int result = (16 * version + 128) * version + 64;
+    if (version >= 2) {
+        int align = version / 7 + 2;
+        result -= (25 * align - 10) * align - 55;
+        if (version >= 7) result -= 36;
+    }
+    return result;
+}
+
+static int data_codewords(int version) {
+    return raw_module_count(version) / 8 - ecc_per_block[version] * block_count[version];
+}
+
+// ---- Reed-Solomon over GF(256) with polynomial 0x11D ----
+
+typedef struct {
+    uint8_t exp[512];  // Doubled so log sums need no reduction
+    uint8_t log[256];
+} GfTables;
+
+static void gf_init(GfTables *gf) {
+    int x = 1;
+    for (int i = 0; i < 255; i++) {
+        gf->exp[i] = gf->exp[i + 255] = (uint8_t)x;
+        gf->log[x] = (uint8_t)i;
+        x = (x << 1) ^ ((x >> 7) * 0x11D);
+    }
+    gf->exp[510] = gf->exp[511] = 0;
+    gf->log[0] = 0;
+}
+
+static uint8_t gf_multiply(const GfTables *gf, uint8_t x, uint8_t y) {
+    if (x == 0 || y == 0) return 0;
+    return gf->exp[gf->log[x] + gf->log[y]];
+}
+
+// Generator polynomial of the given degree, leading coefficient omitted
+static void rs_divisor(const GfTables *gf, int degree, uint8_t *divisor) {
+    memset(divisor, 0, (size_t)degree);
+    divisor[degree - 1] = 1;
+    for (int i = 0; i < degree; i++) {
+        uint8_t root = gf->exp[i];
+        for (int j = 0; j < degree; j++) {
+            divisor[j] = gf_multiply(gf, divisor[j], root);
+            if (j + 1 < degree) divisor[j] ^= divisor[j + 1];
+        }
+    }
+}
+
+static void rs_remainder(const GfTables *gf, const uint8_t *data, int len, const uint8_t *divisor,
+                         int degree, uint8_t *out) {
+    memset(out, 0, (size_t)degree);
+    for (int i = 0; i < len; i++) {
+        uint8_t factor = data[i] ^ out[0];
+        memmove(out, out + 1, (size_t)(degree - 1));
+        out[degree - 1] = 0;
+        if (factor == 0) continue;
+        int log_factor = gf->log[factor];
+        for (int j = 0; j < degree; j++) {
+            if (divisor[j]) out[j] ^= gf->exp[gf->log[divisor[j]] + log_factor];
+        }
+    }
+}
+
+static void set_function(Builder *b, int x, int y, bool dark) {
+    b->qr->modules[y][x] = dark;
+    b->is_function[y][x] = 1;
+}
+
+static void draw_finder(Builder *b, int cx, int cy) {
+    int size = b->qr->size;
+    for (int dy = -4; dy <= 4; dy++) {
+        for (int dx = -4; dx <= 4; dx++) {
+            int x = cx + dx, y = cy + dy;
+            if (x < 0 || x >= size || y < 0 || y >= size) continue;
+            int dist = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+            set_function(b, x, y, dist != 2 && dist != 4);
+        }
+    }
+}
+
+static void draw_alignment(Builder *b, int cx, int cy) {
+    for (int dy = -2; dy <= 2; dy++) {
+        for (int dx = -2; dx <= 2; dx++) {
+            int dist = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+            set_function(b, cx + dx, cy + dy, dist != 1);
+        }
+    }
+}
+
+static int alignment_positions(int version, int *out) {
+    if (version == 1) return 0;
+    int count = version / 7 + 2;
+    int step = (version * 4 + count * 2 + 1) / (count * 2 - 2) * 2;
+    int size = 17 + 4 * version;
+    out[0] = 6;
+    for (int i = count - 1, pos = size - 7; i >= 1; i--, pos -= step) {
+        out[i] = pos;
+    }
+    return count;
+}
+
+static void draw_format_bits(Builder *b, int mask) {
+    int data = FORMAT_BITS_LEVEL_M << 3 | mask;
+    int rem = data;
+    for (int i = 0; i < 10; i++) rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+    int bits = (data << 10 | rem) ^ 0x5412;
+    int size = b->qr->size;
+
+    // Copy around the top-left finder
+    for (int i = 0; i <= 5; i++) set_function(b, 8, i, (bits >> i) & 1);
+    set_function(b, 8, 7, (bits >> 6) & 1);
+    set_function(b, 8, 8, (bits >> 7) & 1);
+    set_function(b, 7, 8, (bits >> 8) & 1);
+    for (int i = 9; i < 15; i++) set_function(b, 14 - i, 8, (bits >> i) & 1);
+
+    // Copy split between the other two finders
+    for (int i = 0; i < 8; i++) set_function(b, size - 1 - i, 8, (bits >> i) & 1);
+    for (int i = 8; i < 15; i++) set_function(b, 8, size - 15 + i, (bits >> i) & 1);
+    set_function(b, 8, size - 8, true);  // Always dark
+}
+
+static void draw_version_bits(Builder *b) {
+    int version = b->qr->version;
+    if (version < 7) return;
+
+    int rem = version;
+    for (int i = 0; i < 12; i++) rem = (rem << 1) ^ ((rem >> 11) * 0x1F25);
+    long bits = (long)version << 12 | rem;
+    int size = b->qr->size;
+    for (int i = 0; i < 18; i++) {
+        bool dark = (bits >> i) & 1;
+        int a = size - 11 + i % 3, c = i / 3;
+        set_function(b, a, c, dark);
+        set_function(b, c, a, dark);
+    }
+}
+
+static void draw_function_patterns(Builder *b) {
+    int size = b->qr->size;
+    for (int i = 0; i < size; i++) {
+        set_function(b, 6, i, i % 2 == 0);
+        set_function(b, i, 6, i % 2 == 0);
+    }
+
+    draw_finder(b, 3, 3);
+    draw_finder(b, size - 4, 3);
+    draw_finder(b, 3, size - 4);
+
+    int pos[7];
+    int count = alignment_positions(b->qr->version, pos);
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < count; j++) {
+            // Skip the three that would overlap finder patterns
+            if ((i == 0 && j == 0) || (i == 0 && j == count - 1) || (i == count - 1 && j == 0)) {
+                continue;
+            }
+            draw_alignment(b, pos[i], pos[j]);
+        }
+    }
+
+    draw_format_bits(b, 0);  // Reserve the area; real bits come with the mask
+    draw_version_bits(b);
+}
+
+// ---- Codeword construction and placement ----
+
+// Split data into blocks, append error correction and interleave
+static int build_codewords(int version, const uint8_t *data, uint8_t *out) {
+    int blocks = block_count[version];
+    int ecc_len = ecc_per_block[version];
+    int raw = raw_module_count(version) / 8;
+    int short_blocks = blocks - raw % blocks;
+    int short_len = raw / blocks;          // Including error correction
+
+    GfTables gf;
+    gf_init(&gf);
+    uint8_t divisor[QR_MAX_ECC];
+    rs_divisor(&gf, ecc_len, divisor);
+
+    uint8_t ecc[8][QR_MAX_ECC];
+    const uint8_t *block_data[8];
+    int block_len[8];
+    for (int i = 0, k = 0; i < blocks; i++) {
+        block_len[i] = short_len - ecc_len + (i < short_blocks ? 0 : 1);
+        block_data[i] = data + k;
+        rs_remainder(&gf, data + k, block_len[i], divisor, ecc_len, ecc[i]);
+        k += block_len[i];
+    }
+
+    int n = 0;
+    for (int i = 0; i <= short_len - ecc_len; i++) {
+        for (int j = 0; j < blocks; j++) {
+            if (i < block_len[j]) out[n++] = block_data[j][i];
+        }
+    }
+    for (int i = 0; i < ecc_len; i++) {
+        for (int j = 0; j < blocks; j++) out[n++] = ecc[j][i];
+    }
+    return n;
+}
+
+static void place_codewords(Builder *b, const uint8_t *codewords, int len) {
+    int size = b->qr->size;
+    int bit = 0;
+    for (int right = size - 1; right >= 1; right -= 2) {
+        if (right == 6) right = 5;  // Skip the vertical timing column
+        bool upward = ((right + 1) & 2) == 0;
+        for (int v = 0; v < size; v++) {
+            int y = upward ? size - 1 - v : v;
+            for (int j = 0; j < 2; j++) {
+                int x = right - j;
+                if (b->is_function[y][x]) continue;
+                // Remainder bits past the last codeword stay light
+                if (bit < len * 8) {
+                    b->qr->modules[y][x] = (codewords[bit >> 3] >> (7 - (bit & 7))) & 1;
+                    bit++;
+                }
+            }
+        }
+    }
+}
+
+static bool mask_bit(int mask, int x, int y) {
+    switch (mask) {
+        case 0: return (x + y) % 2 == 0;
+        case 1: return y % 2 == 0;
+        case 2: return x % 3 == 0;
+        case 3: return (x + y) % 3 == 0;
+        case 4: return (x / 3 + y / 2) % 2 == 0;
+        case 5: return x * y % 2 + x * y % 3 == 0;
+        case 6: return (x * y % 2 + x * y % 3) % 2 == 0;
+        default: return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    }
+}
+
+// XOR is its own inverse, so applying a mask twice removes it
+static void apply_mask(Builder *b, int mask) {
+    int size = b->qr->size;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            if (!b->is_function[y][x] && mask_bit(mask, x, y)) b->qr->modules[y][x] ^= 1;
+        }
+    }
+}
+
+// ---- Mask penalty (the four rules of the standard) ----
+
+// Rows and columns are scored as bitmasks, bit i being module i; modules
+// past either end read as light, like the quiet zone around the symbol.
+
+// Rules 1 and 3 for one row or column
+static int line_penalty(uint64_t line, int size) {
+    // Runs of five or more same-colored modules score run length - 2.
+    // same has bit i set when modules i and i + 1 match, so a run of n
+    // sets n - 4 bits in five, one of them at its start.
+    uint64_t same = ~(line ^ (line >> 1)) & ((1ULL << (size - 1)) - 1);
+    uint64_t five = same & (same >> 1) & (same >> 2) & (same >> 3);
+    uint64_t starts = five & ~(same << 1);
+    int penalty = __builtin_popcountll(five) + 2 * __builtin_popcountll(starts);
+
+    // A dark:light:dark:light:dark 1:1:3:1:1 core with four light modules
+    // after it or before it
+    uint64_t core = line & (~line >> 1) & (line >> 2) & (line >> 3) & (line >> 4) &
+                    (~line >> 5) & (line >> 6);
+    uint64_t light_after = ~((line >> 7) | (line >> 8) | (line >> 9) | (line >> 10));
+    uint64_t light_before = ~((line << 1) | (line << 2) | (line << 3) | (line << 4));
+    penalty += 40 * (__builtin_popcountll(core & light_after) +
+                     __builtin_popcountll(core & light_before));
+    return penalty;
+}
+
+static int penalty_score(const QrCode *qr) {
+    int size = qr->size, penalty = 0, dark = 0;
+    uint64_t rows[QR_MAX_SIZE] = {0}, cols[QR_MAX_SIZE] = {0};
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            uint64_t m = qr->modules[y][x];
+            rows[y] |= m << x;
+            cols[x] |= m << y;
+        }
+    }
+
+    for (int i = 0; i < size; i++) {
+        penalty += line_penalty(rows[i], size) + line_penalty(cols[i], size);
+        dark += __builtin_popcountll(rows[i]);
+    }
+
+    // 2x2 blocks of one color
+    uint64_t inner = (1ULL << (size - 1)) - 1;
+    for (int y = 0; y + 1 < size; y++) {
+        uint64_t vertical = rows[y] ^ rows[y + 1];
+        uint64_t mixed = vertical | (vertical >> 1) | (rows[y] ^ (rows[y] >> 1));
+        penalty += 3 * __builtin_popcountll(~mixed & inner);
+    }
+
+    // 10 points per 5% step away from half dark
+    int total = size * size;
+    int k = (abs(dark * 20 - total * 10) + total - 1) / total - 1;
+    if (k > 0) penalty += k * 10;
+    return penalty;
+}
+
+// ---- Public API ----
+
+static void append_bits(uint8_t *buf, int *bit_len, unsigned value, int count) {
+    for (int i = count - 1; i >= 0; i--, (*bit_len)++) {
+        if ((value >> i) & 1) buf[*bit_len >> 3] |= (uint8_t)(0x80 >> (*bit_len & 7));
+    }
+}
+
+bool qr_encode(const char *text, QrCode *qr) {
+    if (!text || !qr) return false;
+
+    size_t len = strlen(text);
+    int version = 1;
+    for (; version <= QR_MAX_VERSION; version++) {
+        int count_bits = version <= 9 ? 8 : 16;
+        if ((size_t)(4 + count_bits) + len * 8 <= (size_t)data_codewords(version) * 8) break;
+    }
+    if (version > QR_MAX_VERSION) return false;
+
+    // Byte mode segment, terminator and padding
+    int capacity = data_codewords(version);
+    uint8_t data[QR_MAX_CODEWORDS];
+    memset(data, 0, sizeof(data));
+    int bit_len = 0;
+    append_bits(data, &bit_len, 0x4, 4);
+    append_bits(data, &bit_len, (unsigned)len, version <= 9 ? 8 : 16);
+    for (size_t i = 0; i < len; i++) append_bits(data, &bit_len, (uint8_t)text[i], 8);
+    int terminator = capacity * 8 - bit_len;
+    append_bits(data, &bit_len, 0, terminator < 4 ? terminator : 4);
+    bit_len = (bit_len + 7) & ~7;
+    for (uint8_t pad = 0xEC; bit_len < capacity * 8; pad ^= 0xEC ^ 0x11) {
+        append_bits(data, &bit_len, pad, 8);
+    }
+
+    uint8_t codewords[QR_MAX_CODEWORDS];
+    int n = build_codewords(version, data, codewords);
+
+    Builder b;
+    memset(&b, 0, sizeof(b));
+    memset(qr, 0, sizeof(*qr));
+    b.qr = qr;
+    qr->version = version;
+    qr->size = 17 + 4 * version;
+    draw_function_patterns(&b);
+    place_codewords(&b, codewords, n);
+
+    int best_mask = 0, best_penalty = -1;
+    for (int mask = 0; mask < 8; mask++) {
+        apply_mask(&b, mask);
+        draw_format_bits(&b, mask);
+        int penalty = penalty_score(qr);
+        if (best_penalty < 0 || penalty < best_penalty) {
+            best_mask = mask;
+            best_penalty = penalty;
+        }
+        apply_mask(&b, mask);
+    }
+    apply_mask(&b, best_mask);
+    draw_format_bits(&b, best_mask);
+    return true;
+}
+
+// SVG path data for the dark modules, one rectangle per horizontal run,
+// offset by the quiet zone. Returns the length the full path needs, like
+// snprintf; the output is truncated if size is too small.
+int qr_svg_path(const QrCode *qr, char *out, size_t size) {
+    size_t used = 0;
+    for (int y = 0; y < qr->size; y++) {
+        for (int x = 0; x < qr->size; x++) {
+            if (!qr->modules[y][x]) continue;
+            int run = 1;
+            while (x + run < qr->size && qr->modules[y][x + run]) run++;
+            int n = snprintf(used < size ? out + used : NULL, used < size ? size - used : 0,
+                             "M%d %dh%dv1h-%dz", x + QR_QUIET_ZONE, y + QR_QUIET_ZONE, run, run);
+            used += (size_t)n;
+            x += run - 1;
+        }
+    }
+    if (size > 0 && used >= size) out[size - 1] = '\0';
+    return (int)used;
+}
+
+bool qr_write_svg(const QrCode *qr, FILE *fp) {
+    int dim = qr->size + 2 * QR_QUIET_ZONE;
+    int len = qr_svg_path(qr, NULL, 0);
+    char *path = malloc((size_t)len + 1);
+    if (!path) return false;
+    qr_svg_path(qr, path, (size_t)len + 1);
+
+    fprintf(fp, "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 %d %d\" "
+                "shape-rendering=\"crispEdges\">\n", dim, dim);
+    fprintf(fp, "<rect width=\"100%%\" height=\"100%%\" fill=\"#fff\"/>\n");
+    fprintf(fp, "<path fill=\"#000\" d=\"%s\"/>\n</svg>\n", path);
+    free(path);
+    return !ferror(fp);
+}
+
+// Plain PBM, one character per module including the quiet zone
+bool qr_write_pbm(const QrCode *qr, FILE *fp) {
+    int dim = qr->size + 2 * QR_QUIET_ZONE;
+    fprintf(fp, "P1\n%d %d\n", dim, dim);
+    for (int y = 0; y < dim; y++) {
+        for (int x = 0; x < dim; x++) {
+            int qx = x - QR_QUIET_ZONE, qy = y - QR_QUIET_ZONE;
+            bool dark = qx >= 0 && qy >= 0 && qx < qr->size && qy < qr->size && qr->modules[qy][qx];
+            fputc(dark ? '1' : '0', fp);
+        }
+        fputc('\n', fp);
+    }
+    return !ferror(fp);
+}
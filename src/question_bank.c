@@ -0,0 +1,297 @@
+#include "../include/question_bank.h"
+#include "../include/file_lock.h"
+#include "../include/logger.h"
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define BANK_MAGIC 0x4b4e4251u  // "QBNK"
+#define BANK_VERSION 1
+#define OPTION_COUNT 4
+
+// Largest payload: marks, difficulty, then text and options, each prefixed
+// with its length
+#define MAX_ENCODED (4 + 1 + 2 + MAX_QUESTION_TEXT + OPTION_COUNT * (2 + MAX_OPTION_LENGTH))
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+} BankHeader;
+
+typedef struct {
+    uint32_t length;     // Payload bytes that follow
+    int32_t question_id;
+    uint64_t hash;       // FNV-1a of the payload
+} RecordHeader;
+
+typedef struct {
+    int32_t id;
+    uint32_t length;
+    uint64_t hash;
+    off_t offset;        // Of the payload
+} BankEntry;
+
+static int bank_fd = -1;
+static BankEntry *entries = NULL;   // In file order, so by ascending ID
+static size_t entry_count = 0;
+static size_t entry_cap = 0;
+static int32_t *by_hash = NULL;     // Entry numbers, open addressing on hash
+static size_t hash_cap = 0;
+static off_t indexed_to = 0;        // End of the last complete record indexed
+
+static uint64_t hash_payload(const uint8_t *data, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+static size_t encode_question(const Question *q, uint8_t *out) {
+    size_t n = 0;
+    int32_t marks = q->marks;
+    memcpy(out + n, &marks, sizeof(marks));
+    n += sizeof(marks);
+    out[n++] = (uint8_t)q->difficulty;
+
+    uint16_t text_len = (uint16_t)strnlen(q->text, MAX_QUESTION_TEXT - 1);
+    memcpy(out + n, &text_len, sizeof(text_len));
+    n += sizeof(text_len);
+    memcpy(out + n, q->text, text_len);
+    n += text_len;
+
+    for (int i = 0; i < OPTION_COUNT; i++) {
+        uint8_t len = (uint8_t)strnlen(q->options[i].text, MAX_OPTION_LENGTH - 1);
+        out[n++] = q->options[i].is_correct ? 1 : 0;
+        out[n++] = len;
+        memcpy(out + n, q->options[i].text, len);
+        n += len;
+    }
+    return n;
+}
+
+static bool decode_question(const uint8_t *in, size_t length, Question *q) {
+    memset(q, 0, sizeof(*q));
+    size_t n = 0;
+
+    int32_t marks;
+    uint16_t text_len;
+    if (length < sizeof(marks) + 1 + sizeof(text_len)) return false;
+    memcpy(&marks, in + n, sizeof(marks));
+    n += sizeof(marks);
+    q->marks = marks;
+    q->difficulty = (char)in[n++];
+
+    memcpy(&text_len, in + n, sizeof(text_len));
+    n += sizeof(text_len);
+    if (text_len >= MAX_QUESTION_TEXT || n + text_len > length) return false;
+    memcpy(q->text, in + n, text_len);
+    n += text_len;
+
+    for (int i = 0; i < OPTION_COUNT; i++) {
+        if (n + 2 > length) return false;
+        q->options[i].is_correct = in[n++] != 0;
+        uint8_t len = in[n++];
+        if (len >= MAX_OPTION_LENGTH || n + len > length) return false;
+        memcpy(q->options[i].text, in + n, len);
+        n += len;
+    }
+    return n == length;
+}
+
+static void hash_insert(int32_t entry) {
+    size_t i = (size_t)entries[entry].hash & (hash_cap - 1);
+    while (by_hash[i] >= 0) i = (i + 1) & (hash_cap - 1);
+    by_hash[i] = entry;
+}
+
+static bool add_entry(int32_t id, uint32_t length, uint64_t hash, off_t offset) {
+    if (entry_count == entry_cap) {
+        size_t cap = entry_cap ? entry_cap * 2 : 1024;
+        BankEntry *grown = realloc(entries, cap * sizeof(BankEntry));
+        if (!grown) return false;
+        entries = grown;
+        entry_cap = cap;
+    }
+    if ((entry_count + 1) * 2 > hash_cap) {
+        size_t cap = hash_cap ? hash_cap * 2 : 2048;
+        int32_t *table = malloc(cap * sizeof(int32_t));
+        if (!table) return false;
+        for (size_t i = 0; i < cap; i++) table[i] = -1;
+        free(by_hash);
+        by_hash = table;
+        hash_cap = cap;
+        for (size_t e = 0; e < entry_count; e++) hash_insert((int32_t)e);
+    }
+
+    BankEntry *e = &entries[entry_count];
+    e->id = id;
+    e->length = length;
+    e->hash = hash;
+    e->offset = offset;
+    hash_insert((int32_t)entry_count++);
+    return true;
+}
+
+static bool open_bank(void) {
+    if (bank_fd >= 0) return true;
+    bank_fd = open(QUESTION_BANK_FILE, O_RDWR | O_CREAT, 0644);
+    if (bank_fd < 0) {
+        log_message(LOG_ERROR, "Failed to open question bank");
+        return false;
+    }
+    return true;
+}
+
+// Index the records other processes appended since the last call. Without
+// the append lock a record being written is simply not indexed yet; with
+// it (repair), an incomplete record can only be a crash leftover and is cut
+// off so the next append starts on a clean boundary.
+static bool catch_up(bool repair) {
+    struct stat st;
+    if (fstat(bank_fd, &st) != 0) return false;
+
+    if (indexed_to == 0) {
+        BankHeader hdr;
+        if (st.st_size < (off_t)sizeof(hdr)) {
+            if (!repair) return true;  // Nothing written yet
+            hdr.magic = BANK_MAGIC;
+            hdr.version = BANK_VERSION;
+            if (ftruncate(bank_fd, 0) != 0 ||
+                pwrite(bank_fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) {
+                log_message(LOG_ERROR, "Failed to initialize question bank");
+                return false;
+            }
+            st.st_size = sizeof(hdr);
+        } else if (pread(bank_fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+                   hdr.magic != BANK_MAGIC || hdr.version != BANK_VERSION) {
+            log_message(LOG_ERROR, "Question bank has an unsupported format");
+            return false;
+        }
+        indexed_to = sizeof(hdr);
+    }
+
+    uint8_t payload[MAX_ENCODED];
+    RecordHeader rh;
+    while (indexed_to + (off_t)sizeof(rh) <= st.st_size) {
+        off_t body = indexed_to + (off_t)sizeof(rh);
+        int32_t last_id = entry_count ? entries[entry_count - 1].id : 0;
+        bool complete = pread(bank_fd, &rh, sizeof(rh), indexed_to) == (ssize_t)sizeof(rh) &&
+                        rh.length <= MAX_ENCODED && rh.question_id > last_id &&
+                        body + (off_t)rh.length <= st.st_size &&
+                        pread(bank_fd, payload, rh.length, body) == (ssize_t)rh.length &&
+                        hash_payload(payload, rh.length) == rh.hash;
+        if (!complete) break;
+        if (!add_entry(rh.question_id, rh.length, rh.hash, body)) {
+            log_message(LOG_ERROR, "Memory allocation failed for question bank index");
+            return false;
+        }
+        indexed_to = body + (off_t)rh.length;
+    }
+
+    if (repair && indexed_to < st.st_size) {
+        log_message(LOG_WARNING, "Dropping incomplete question bank record at %lld",
+                    (long long)indexed_to);
+        if (ftruncate(bank_fd, indexed_to) != 0) return false;
+    }
+    return true;
+}
+
+// ID of a stored question with exactly this payload, or 0
+static int find_duplicate(const uint8_t *payload, size_t length, uint64_t hash) {
+    if (hash_cap == 0) return 0;
+
+    uint8_t stored[MAX_ENCODED];
+    for (size_t i = (size_t)hash & (hash_cap - 1); by_hash[i] >= 0; i = (i + 1) & (hash_cap - 1)) {
+        const BankEntry *e = &entries[by_hash[i]];
+        if (e->hash != hash || e->length != length) continue;
+        if (pread(bank_fd, stored, length, e->offset) == (ssize_t)length &&
+            memcmp(stored, payload, length) == 0) {
+            return e->id;
+        }
+    }
+    return 0;
+}
+
+static const BankEntry* find_entry(int question_id) {
+    size_t lo = 0, hi = entry_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].id < question_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < entry_count && entries[lo].id == question_id) ? &entries[lo] : NULL;
+}
+
+// ID of the bank's copy of question, appending it if the bank has none.
+// The question's own question_id is ignored. Returns 0 on failure.
+int question_bank_intern(const Question *question) {
+    if (!question || !open_bank()) return 0;
+
+    uint8_t record[sizeof(RecordHeader) + MAX_ENCODED];
+    uint8_t *payload = record + sizeof(RecordHeader);
+    size_t length = encode_question(question, payload);
+    uint64_t hash = hash_payload(payload, length);
+
+    // Most questions saved with a paper are already in the bank
+    if (!catch_up(false)) return 0;
+    int id = find_duplicate(payload, length, hash);
+    if (id) return id;
+
+    if (!file_lock(bank_fd, FILE_LOCK_APPEND_BYTE, 1, FILE_LOCK_EXCLUSIVE)) return 0;
+
+    // Another terminal may have added it while we waited
+    bool ok = catch_up(true);
+    id = ok ? find_duplicate(payload, length, hash) : 0;
+    if (ok && id == 0) {
+        RecordHeader rh = { (uint32_t)length, entry_count ? entries[entry_count - 1].id + 1 : 1, hash };
+        memcpy(record, &rh, sizeof(rh));
+        size_t bytes = sizeof(rh) + length;
+        off_t at = indexed_to;
+
+        // Papers referring to the question are written after it, so make
+        // sure it reaches the disk first
+        ok = pwrite(bank_fd, record, bytes, at) == (ssize_t)bytes && fdatasync(bank_fd) == 0 &&
+             add_entry(rh.question_id, rh.length, hash, at + (off_t)sizeof(rh));
+        if (ok) {
+            indexed_to = at + (off_t)bytes;
+            id = rh.question_id;
+        } else {
+            log_message(LOG_ERROR, "Failed to append to question bank");
+        }
+    }
+
+    file_unlock(bank_fd, FILE_LOCK_APPEND_BYTE, 1);
+    return id;
+}
+
+bool question_bank_load(int question_id, Question *question) {
+    if (!question || !open_bank()) return false;
+
+    const BankEntry *e = find_entry(question_id);
+    if (!e) {
+        // Possibly added by another process since we last looked
+        if (!catch_up(false)) return false;
+        e = find_entry(question_id);
+        if (!e) return false;
+    }
+
+    uint8_t payload[MAX_ENCODED];
+    if (pread(bank_fd, payload, e->length, e->offset) != (ssize_t)e->length ||
+        hash_payload(payload, e->length) != e->hash ||
+        !decode_question(payload, e->length, question)) {
+        log_message(LOG_ERROR, "Question %d is damaged in the question bank", question_id);
+        return false;
+    }
+    question->question_id = question_id;
+    return true;
+}
+
+int question_bank_count(void) {
+    if (!open_bank() || !catch_up(false)) return 0;
+    return (int)entry_count;
+}
@@ -0,0 +1,99 @@
+#include "../include/scoring.h"
+#include "../include/logger.h"
+
+#define OPTION_COUNT 4                       // Fits a nibble
+#define NIBBLE_LOW 0x1111111111111111ull
+
+// Bit 4k set where nibble k has any bit set
+static inline uint64_t nibbles_set(uint64_t x) {
+    x |= x >> 1;
+    x |= x >> 2;
+    return x & NIBBLE_LOW;
+}
+
+// Share of a question's marks lost for a wrong answer, from the system
+// configuration
+double scoring_negative_fraction(void) {
+    SystemConfig config = load_system_config();
+    if (config.negative_marking_percent < 0) return 0.0;
+    int percent = config.negative_marking_percent ? config.negative_marking_percent
+                                                  : SCORING_DEFAULT_NEGATIVE_PERCENT;
+    return percent / 100.0;
+}
+
+bool scoring_compile_key(const ExamPaper *paper, double negative_fraction, AnswerKey *key) {
+    if (!paper || !key) return false;
+    if (paper->num_questions < 0 || paper->num_questions > MAX_QUESTIONS_PER_PAPER) {
+        log_message(LOG_ERROR, "Exam paper %d has an invalid question count", paper->paper_id);
+        return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->paper_id = paper->paper_id;
+    key->num_questions = paper->num_questions;
+    key->words = (paper->num_questions + 15) / 16;
+    key->negative_fraction = negative_fraction;
+
+    int all_marks = 0;
+    for (int q = 0; q < paper->num_questions; q++) {
+        const Question *question = &paper->questions[q];
+        if (question->marks < 0 || question->marks >= (1 << SCORING_MARK_BITS)) {
+            log_message(LOG_ERROR, "Question %d of exam paper %d has unsupported marks %d",
+                        q + 1, paper->paper_id, question->marks);
+            return false;
+        }
+
+        int w = q / 16, shift = (q % 16) * 4;
+        for (int i = 0; i < OPTION_COUNT; i++) {
+            if (question->options[i].is_correct) key->key[w] |= 1ull << (shift + i);
+        }
+        key->present[w] |= 1ull << shift;
+        for (int b = 0; b < SCORING_MARK_BITS; b++) {
+            if (question->marks & (1 << b)) key->planes[b][w] |= 1ull << shift;
+        }
+        all_marks |= question->marks;
+    }
+    while (key->mark_bits < SCORING_MARK_BITS && (all_marks >> key->mark_bits) != 0) key->mark_bits++;
+    return true;
+}
+
+// Pack chosen option indexes (0-3) into a sheet; anything else counts as
+// unanswered
+void scoring_pack_answers(const int *answers, int count, AnswerSheet *sheet) {
+    memset(sheet, 0, sizeof(*sheet));
+    if (count > MAX_QUESTIONS_PER_PAPER) count = MAX_QUESTIONS_PER_PAPER;
+    for (int q = 0; q < count; q++) {
+        if (answers[q] < 0 || answers[q] >= OPTION_COUNT) continue;
+        sheet->words[q / 16] |= 1ull << ((q % 16) * 4 + answers[q]);
+    }
+}
+
+void scoring_score_batch(const AnswerKey *key, const AnswerSheet *sheets, size_t count, ExamScore *scores) {
+    const int words = key->words, planes = key->mark_bits;
+
+    for (size_t s = 0; s < count; s++) {
+        const uint64_t *sheet = sheets[s].words;
+        int right = 0, wrong = 0, marks_right = 0, marks_wrong = 0;
+
+        for (int w = 0; w < words; w++) {
+            uint64_t answered = nibbles_set(sheet[w]) & key->present[w];
+            uint64_t differs = nibbles_set(sheet[w] ^ key->key[w]);
+            uint64_t hit = answered & ~differs;
+            uint64_t miss = answered & differs;
+            right += __builtin_popcountll(hit);
+            wrong += __builtin_popcountll(miss);
+            for (int b = 0; b < planes; b++) {
+                marks_right += __builtin_popcountll(hit & key->planes[b][w]) << b;
+                marks_wrong += __builtin_popcountll(miss & key->planes[b][w]) << b;
+            }
+        }
+
+        ExamScore *out = &scores[s];
+        out->right = (int16_t)right;
+        out->wrong = (int16_t)wrong;
+        out->unanswered = (int16_t)(key->num_questions - right - wrong);
+        out->marks_right = marks_right;
+        out->marks_wrong = marks_wrong;
+        out->score = marks_right - key->negative_fraction * marks_wrong;
+    }
+}
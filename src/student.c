@@ -1,9 +1,19 @@
 #include "../include/student.h"
 #include "../include/common.h"
+#include "../include/student_index.h"
+#include "../include/student_store.h"
+#include "../include/student_name_index.h"
+#include "../include/student_filter_index.h"
+#include "../include/student_text_index.h"
+#include "../include/student_cache.h"
+#include "../include/student_wal.h"
+#include "../include/qr.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <limits.h>
 
 // Search for a student by ID or name
 void search_student(FILE *fp) {
@@ -14,7 +24,7 @@ void search_student(FILE *fp) {
     printf("\n\t\t--------------");
     
     printf("\n\n\t\t1. Search by ID");
-    printf("\n\t\t2. Search by Name");
+    printf("\n\t\t2. Search by Name, Email or School");
     printf("\n\t\t0. Back");
     
     int choice = get_menu_choice(0, 2);
@@ -33,47 +43,34 @@ void search_student(FILE *fp) {
         }
         clear_input_buffer();
         
-        rewind(fp);
-        Student s;
-        bool found = false;
-        
         printf("\n\t\tSearch Results:");
         printf("\n\t\t--------------");
         
-        while (fread(&s, sizeof(Student), 1, fp) == 1) {
-            if (s.id == search_id) {
-                show_student_details(&s);
-                found = true;
-                break;
-            }
-        }
-        
-        if (!found) {
+        const Student *s = get_student(search_id);
+        if (s) {
+            show_student_details(s);
+        } else {
             printf("\n\t\tNo student found with ID: %d", search_id);
         }
     } 
     else if (choice == 2) {
         // Search by Name
         char search_name[MAX_NAME];
-        printf("\n\t\tEnter Student Name to search: ");
+        printf("\n\t\tEnter a name, email or school (misspellings are fine): ");
         safe_input(search_name, sizeof(search_name));
         
-        rewind(fp);
-        Student s;
-        bool found = false;
-        
         printf("\n\t\tSearch Results:");
         printf("\n\t\t--------------");
         
-        while (fread(&s, sizeof(Student), 1, fp) == 1) {
-            if (strcasecmp(s.name, search_name) == 0) {
-                show_student_details(&s);
-                found = true;
-            }
+        int count = 0;
+        const Student **matches = search_students(search_name, &count);
+        for (int i = 0; i < count; i++) {
+            show_student_details(matches[i]);
         }
+        free(matches);
         
-        if (!found) {
-            printf("\n\t\tNo student found with name: %s", search_name);
+        if (count == 0) {
+            printf("\n\t\tNo student found matching: %s", search_name);
         }
     }
     
@@ -99,25 +96,74 @@ void show_student_details(const Student *s) {
     printf("\n\t\tRegistered: %s", ctime(&s->created_at));
 }
 
+// Generation of the student file that the in-memory secondary indexes
+// reflect. When another process writes the file the header moves past it,
+// and the indexes are dropped to be rebuilt on next use.
+static uint64_t indexed_generation = 0;
+
+// Call after student_store_refresh() (or with the store lock held)
+static void follow_other_writers(void) {
+    uint64_t generation = student_store_header()->generation;
+    if (generation == indexed_generation) return;
+    student_name_index_invalidate();
+    student_filter_index_invalidate();
+    student_text_index_invalidate();
+    indexed_generation = generation;
+}
+
+// Every mutation runs under the store's writer lock, which serializes
+// record number assignment and index maintenance across threads and
+// processes. Journal commits happen outside it so concurrent writers share
+// one fsync.
+static bool begin_student_write(void) {
+    if (!student_store_lock()) return false;
+    follow_other_writers();
+    return true;
+}
+
+// Keep the secondary indexes in step with a record change (old is NULL for
+// a new record)
+static void update_secondary_indexes(long recno, const Student *old, const Student *updated) {
+    if (!old) {
+        student_name_index_insert(updated->name, recno);
+    } else if (strcmp(old->name, updated->name) != 0) {
+        student_name_index_remove(old->name, recno);
+        student_name_index_insert(updated->name, recno);
+    }
+    student_filter_index_update(recno, old, updated);
+    student_text_index_update(recno, old, updated);
+    indexed_generation = student_store_header()->generation;
+}
+
+// Wait for the journal record, then checkpoint if the journal has grown large
+static bool commit_student_change(uint64_t lsn) {
+    bool success = student_wal_commit(lsn);
+    if (success && student_wal_needs_checkpoint() && student_store_lock()) {
+        student_wal_checkpoint();
+        student_store_unlock();
+    }
+    return success;
+}
+
 // Add a new student
 bool add_student(Student *student) {
     if (!student) return false;
 
-    FILE *fp = fopen(STUDENT_FILE, "ab+");
-    if (!fp) {
+    if (!begin_student_write()) {
         log_message(LOG_ERROR, "Failed to open student file for writing");
         return false;
     }
 
+    // A zero ID asks for the next free one
+    if (student->id <= 0) {
+        student->id = student_store_header()->next_id;
+    }
+
     // Check if ID already exists
-    Student temp;
-    rewind(fp);
-    while (fread(&temp, sizeof(Student), 1, fp) == 1) {
-        if (temp.id == student->id) {
-            fclose(fp);
-            log_message(LOG_WARNING, "Student with ID %d already exists", student->id);
-            return false;
-        }
+    if (student_index_lookup(student->id, NULL)) {
+        student_store_unlock();
+        log_message(LOG_WARNING, "Student with ID %d already exists", student->id);
+        return false;
     }
     
     // Set metadata
@@ -126,10 +172,24 @@ bool add_student(Student *student) {
     student->updated_at = student->created_at;
     student->created_by = current_user.ID;  // Fixed field name to match User struct
 
-    // Write to file
-    fseek(fp, 0, SEEK_END);
-    bool success = (fwrite(student, sizeof(Student), 1, fp) == 1);
-    fclose(fp);
+    // Journal first, then append to the file
+    long recno = (long)student_store_count();
+    StudentStoreHeader header;
+    student_store_next_header(recno, student, &header);
+    uint64_t lsn = student_wal_append(WAL_OP_INSERT, recno, student, &header);
+    bool success = lsn != 0 && student_store_apply(recno, student, &header);
+
+    if (success && !student_index_insert(student->id, recno)) {
+        log_message(LOG_WARNING, "Student index update failed; it will be rebuilt");
+    }
+    if (success) {
+        update_secondary_indexes(recno, NULL, student);
+    }
+    student_store_unlock();
+
+    if (lsn != 0) {
+        success = commit_student_change(lsn) && success;
+    }
 
     if (success) {
         log_message(LOG_INFO, "Added new student: %s (ID: %d)", student->name, student->id);
@@ -140,21 +200,372 @@ bool add_student(Student *student) {
     return success;
 }
 
-// Generate QR code for student ID card
+// Look up a student by ID, through the cache and then the primary-key index
+const Student* get_student(int student_id) {
+    const Student *s = student_cache_get(student_id);
+    if (s) return s;
+
+    long recno;
+    if (!student_index_lookup(student_id, &recno)) return NULL;
+    if (!student_store_refresh()) return NULL;
+
+    s = student_store_at((size_t)recno);
+    if (!s || s->id != student_id) return NULL;
+    student_cache_put(recno, s);
+    return s;
+}
+
+// Copy a student record out of the store
+bool load_student(int student_id, Student *student) {
+    if (!student) return false;
+
+    const Student *s = get_student(student_id);
+    if (!s) return false;
+    memcpy(student, s, sizeof(Student));
+    return true;
+}
+
+const Student* get_student_by_username(const char *username) {
+    const Student *s = student_cache_get_by_username(username);
+    if (s) return s;
+    if (!username || !student_store_refresh()) return NULL;
+
+    size_t total = student_store_count();
+    for (size_t i = 0; i < total; i++) {
+        s = student_store_at(i);
+        if (strcmp(s->username, username) == 0) {
+            student_cache_put((long)i, s);
+            return s;
+        }
+    }
+    return NULL;
+}
+
+// The mapping is already a contiguous array of records
+const Student* get_students(int *count) {
+    if (count) *count = 0;
+    if (!student_store_refresh()) return NULL;
+
+    size_t total = student_store_count();
+    if (count) *count = (int)total;
+    return total > 0 ? student_store_at(0) : NULL;
+}
+
+// The summary table is also contiguous; listing should prefer it
+const StudentSummary* get_student_summaries(int *count) {
+    if (count) *count = 0;
+    if (!student_store_refresh()) return NULL;
+
+    size_t total = student_store_count();
+    if (count) *count = (int)total;
+    return total > 0 ? student_store_summary(0) : NULL;
+}
+
+// Print a one-line-per-student table from the summary table
+void list_students(void) {
+    int count = 0;
+    const StudentSummary *students = get_student_summaries(&count);
+
+    print_header();
+    printf("\n\n\t\tSTUDENT LIST");
+    printf("\n\t\t------------");
+    printf("\n\n\t\t%-8s %-30s %-8s %-8s %-8s", "ID", "Name", "Grade", "Section", "Status");
+
+    for (int i = 0; i < count; i++) {
+        const StudentSummary *s = &students[i];
+        printf("\n\t\t%-8d %-30.30s %-8s %-8s %-8s", s->id, s->name, s->grade,
+               s->section, s->is_active ? "Active" : "Inactive");
+    }
+
+    printf("\n\n\t\tTotal: %d student(s)", count);
+}
+
+// Names starting with query come first, in name order, followed by up to
+// STUDENT_SEARCH_LIMIT fuzzy matches on name, email, school or parent name,
+// best first
+const Student** search_students(const char *query, int *count) {
+    if (count) *count = 0;
+    if (!query || !student_store_refresh()) return NULL;
+    follow_other_writers();
+
+    int found = 0, fuzzy_found = 0;
+    long *recnos = student_name_index_search(query, true, &found);
+    TextMatch *fuzzy = student_text_index_search(query, STUDENT_SEARCH_LIMIT, &fuzzy_found);
+    if (!recnos && !fuzzy) return NULL;
+
+    const Student **matches = malloc((found + fuzzy_found > 0 ? found + fuzzy_found : 1) * sizeof(*matches));
+    if (!matches) {
+        free(recnos);
+        free(fuzzy);
+        log_message(LOG_ERROR, "Memory allocation failed for student search");
+        return NULL;
+    }
+
+    int n = 0;
+    for (int i = 0; i < found; i++) {
+        const Student *s = student_store_at((size_t)recnos[i]);
+        if (s) matches[n++] = s;
+    }
+    for (int i = 0; i < fuzzy_found; i++) {
+        bool listed = false;
+        for (int j = 0; j < found && !listed; j++) {
+            listed = recnos[j] == fuzzy[i].recno;
+        }
+        const Student *s = listed ? NULL : student_store_at((size_t)fuzzy[i].recno);
+        if (s) matches[n++] = s;
+    }
+    free(recnos);
+    free(fuzzy);
+
+    if (count) *count = n;
+    return matches;
+}
+
+// Combined filter resolved through the bitmap indexes. Pass NULL for grade
+// or section and FILTER_ANY_STATUS for status to leave a criterion out.
+const Student** filter_students(const char *grade, const char *section, int status, int *count) {
+    if (count) *count = 0;
+    if (!student_store_refresh()) return NULL;
+    follow_other_writers();
+
+    int found = 0;
+    long *recnos = student_filter_index_query(grade, section, status, &found);
+    if (!recnos) return NULL;
+
+    const Student **matches = malloc((found > 0 ? found : 1) * sizeof(*matches));
+    if (!matches) {
+        free(recnos);
+        log_message(LOG_ERROR, "Memory allocation failed for student filter");
+        return NULL;
+    }
+
+    int n = 0;
+    for (int i = 0; i < found; i++) {
+        const Student *s = student_store_at((size_t)recnos[i]);
+        if (s) matches[n++] = s;
+    }
+    free(recnos);
+
+    if (count) *count = n;
+    return matches;
+}
+
+const Student** filter_students_by_grade(const char *grade, int *count) {
+    if (!grade) return NULL;
+    return filter_students(grade, NULL, FILTER_ANY_STATUS, count);
+}
+
+const Student** filter_students_by_section(const char *section, int *count) {
+    if (!section) return NULL;
+    return filter_students(NULL, section, FILTER_ANY_STATUS, count);
+}
+
+const Student** filter_students_by_status(bool is_active, int *count) {
+    return filter_students(NULL, NULL, is_active ? 1 : 0, count);
+}
+
+// Rewrite an existing record in place; the ID (and so the index) is unchanged.
+// A delete is applied to the record as it stands under the lock, so only
+// student->id is used.
+static bool write_student_record(const Student *student, int op) {
+    if (!begin_student_write()) return false;
+    long recno;
+    const Student *current = NULL;
+    if (student_index_lookup(student->id, &recno) && student_store_refresh()) {
+        current = student_store_at((size_t)recno);
+    }
+    if (!current) {
+        student_store_unlock();
+        log_message(LOG_WARNING, "Student with ID %d not found", student->id);
+        return false;
+    }
+    Student deleted;
+    if (op == WAL_OP_DELETE) {
+        deleted = *current;
+        deleted.is_active = false;
+        deleted.updated_at = time(NULL);
+        student = &deleted;
+    }
+
+    // The mapped record is overwritten below; keep the old image for the indexes
+    Student old = *current;
+    StudentStoreHeader header;
+    student_store_next_header(recno, student, &header);
+    uint64_t lsn = student_wal_append(op, recno, student, &header);
+    bool success = lsn != 0 && student_store_apply(recno, student, &header);
+    if (success) {
+        update_secondary_indexes(recno, &old, student);
+    }
+    // The username may have changed; the next lookup caches it afresh
+    student_cache_forget(student->id);
+    student_store_unlock();
+
+    if (lsn != 0) {
+        success = commit_student_change(lsn) && success;
+    }
+    return success;
+}
+
+bool update_student(Student *student) {
+    if (!student) return false;
+
+    student->updated_at = time(NULL);
+    bool success = write_student_record(student, WAL_OP_UPDATE);
+    if (success) {
+        log_message(LOG_INFO, "Updated student: %s (ID: %d)", student->name, student->id);
+    } else {
+        log_message(LOG_ERROR, "Failed to update student ID: %d", student->id);
+    }
+    return success;
+}
+
+// Deletion is soft: the record stays in place and keeps its index entry
+bool delete_student(int student_id) {
+    Student s = { .id = student_id };
+    bool success = write_student_record(&s, WAL_OP_DELETE);
+    if (success) {
+        log_message(LOG_INFO, "Deleted student ID: %d", student_id);
+    }
+    return success;
+}
+
+// Statistics come straight from the student file header
+int get_total_students(void) {
+    if (!student_store_refresh()) return 0;
+    return (int)student_store_header()->record_count;
+}
+
+int get_active_students_count(void) {
+    if (!student_store_refresh()) return 0;
+    return (int)student_store_header()->active_count;
+}
+
+int get_inactive_students_count(void) {
+    if (!student_store_refresh()) return 0;
+    const StudentStoreHeader *h = student_store_header();
+    return (int)(h->record_count - h->active_count);
+}
+
+// Students in a grade (active only, or all). Falls back to the filter
+// index if the header ran out of grade slots.
+int get_grade_student_count(const char *grade, bool active_only) {
+    if (!grade || !student_store_refresh()) return 0;
+
+    const StudentStoreHeader *h = student_store_header();
+    for (int i = 0; i < h->grade_count; i++) {
+        if (strncmp(h->grades[i].grade, grade, sizeof(h->grades[i].grade)) == 0) {
+            return active_only ? h->grades[i].active : h->grades[i].total;
+        }
+    }
+    if (!h->grades_overflow) return 0;
+
+    follow_other_writers();
+    int count = 0;
+    long *recnos = student_filter_index_query(grade, NULL, active_only ? 1 : FILTER_ANY_STATUS, &count);
+    free(recnos);
+    return count;
+}
+
+// Drop inactive students last changed before the cutoff
+static bool keep_for_compaction(const Student *student, void *ctx) {
+    time_t cutoff = *(const time_t*)ctx;
+    return student->is_active || student->updated_at > cutoff;
+}
+
+// Online compaction: rewrite the student file without inactive records.
+// Writers are held off for the duration; the journal is checkpointed first
+// because its record numbers do not survive the rewrite.
+bool compact_students(int min_age_days, CompactionStats *stats) {
+    time_t cutoff = time(NULL) - (time_t)min_age_days * 24 * 60 * 60;
+
+    if (!begin_student_write()) return false;
+    bool success = student_wal_checkpoint() &&
+                   student_store_compact(keep_for_compaction, &cutoff, stats);
+    if (success) {
+        student_index_rebuild();
+        student_name_index_invalidate();
+        student_filter_index_invalidate();
+        student_text_index_invalidate();
+    }
+    student_store_unlock();
+
+    if (!success) {
+        log_message(LOG_ERROR, "Student compaction failed");
+    } else if (stats) {
+        log_message(LOG_INFO, "Compacted students: %ld -> %ld records",
+                    stats->records_before, stats->records_after);
+    }
+    return success;
+}
+
+// Write data as a QR code: PBM for a .pbm filename, SVG otherwise
 bool generate_qr_code(const char *data, const char *filename) {
     if (!data || !filename) return false;
 
-    // In a real implementation, this would use a QR code library
-    // For now, just create a text file with the data
+    QrCode *qr = malloc(sizeof(QrCode));
+    if (!qr || !qr_encode(data, qr)) {
+        free(qr);
+        log_message(LOG_ERROR, "QR code data too long to encode");
+        return false;
+    }
+
     FILE *fp = fopen(filename, "w");
-    if (!fp) return false;
+    if (!fp) {
+        free(qr);
+        return false;
+    }
 
-    fprintf(fp, "QR CODE DATA: %s\n", data);
-    fclose(fp);
+    const char *ext = strrchr(filename, '.');
+    bool ok = (ext && strcmp(ext, ".pbm") == 0) ? qr_write_pbm(qr, fp) : qr_write_svg(qr, fp);
+    ok = (fclose(fp) == 0) && ok;
+    free(qr);
+    return ok;
+}
+
+// Check-in payloads are "STUDENT_<id>_<name>" with the name cut to 50 bytes
+#define QR_PAYLOAD_PREFIX "STUDENT_"
+#define QR_PAYLOAD_NAME_MAX 50
+
+// Split a check-in payload into its student ID and name part
+static bool parse_qr_payload(const char *qr_data, int *id, const char **name) {
+    size_t prefix_len = strlen(QR_PAYLOAD_PREFIX);
+    if (strncmp(qr_data, QR_PAYLOAD_PREFIX, prefix_len) != 0) return false;
 
+    const char *p = qr_data + prefix_len;
+    if (!isdigit((unsigned char)*p) || (p[0] == '0' && isdigit((unsigned char)p[1]))) return false;
+
+    long value = 0;
+    while (isdigit((unsigned char)*p)) {
+        value = value * 10 + (*p++ - '0');
+        if (value > INT_MAX) return false;
+    }
+    if (*p != '_') return false;
+
+    *id = (int)value;
+    *name = p + 1;
     return true;
 }
 
+// The check-in payload printed on a student's ID card
+int format_qr_payload(const Student *student, char *out, size_t size) {
+    return snprintf(out, size, QR_PAYLOAD_PREFIX "%d_%.*s", student->id,
+                    QR_PAYLOAD_NAME_MAX, student->name);
+}
+
+// Resolve a check-in payload to its student: the payload is parsed to an
+// ID, looked up through the index and checked against the stored name.
+// Returns NULL for malformed or unmatched payloads.
+const Student* resolve_qr_payload(const char *qr_data) {
+    int id;
+    const char *name;
+    if (!qr_data || !parse_qr_payload(qr_data, &id, &name)) return NULL;
+
+    const Student *s = get_student(id);
+    size_t name_len = s ? strnlen(s->name, QR_PAYLOAD_NAME_MAX) : 0;
+    if (!s || strlen(name) != name_len || memcmp(name, s->name, name_len) != 0) return NULL;
+    return s;
+}
+
 // Check in a student using their QR code
 bool check_in_with_qr(const char *qr_data) {
     if (!qr_data || strlen(qr_data) == 0) {
@@ -162,32 +573,13 @@ bool check_in_with_qr(const char *qr_data) {
         return false;
     }
 
-    FILE *fp = fopen(STUDENT_FILE, "rb");
-    if (!fp) {
-        log_message(LOG_ERROR, "Failed to open student file for QR check-in");
+    const Student *s = resolve_qr_payload(qr_data);
+    if (!s) {
+        log_message(LOG_WARNING, "QR code does not match a registered student");
         return false;
     }
-    
-    Student s;
-    bool found = false;
-    char student_qr[MAX_QR_DATA];
-
-    while (fread(&s, sizeof(Student), 1, fp) == 1) {
-        // Use safer snprintf with size limit and check return value
-        int len = snprintf(student_qr, MAX_QR_DATA, "STUDENT_%d_%.50s", s.id, s.name);
-        if (len < 0 || len >= MAX_QR_DATA) {
-            log_message(LOG_ERROR, "QR code generation failed: buffer too small");
-            continue;
-        }
 
-        if (strcmp(student_qr, qr_data) == 0) {
-            found = true;
-            show_student_details(&s);
-            log_message(LOG_INFO, "Student checked in: %s (ID: %d)", s.name, s.id);
-            break;
-        }
-    }
-    
-    fclose(fp);
-    return found;
+    show_student_details(s);
+    log_message(LOG_INFO, "Student checked in: %s (ID: %d)", s->name, s->id);
+    return true;
 }
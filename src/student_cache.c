@@ -0,0 +1,263 @@
+#include "../include/student_cache.h"
+#include "../include/student_store.h"
+#include "../include/logger.h"
+#include <pthread.h>
+#include <stdint.h>
+
+#define NO_ENTRY (-1)
+
+typedef struct {
+    int32_t id;
+    int32_t recno;       // NO_ENTRY while the entry is free
+    uint32_t name_hash;
+    int32_t next_id;     // Next entry in the same ID bucket, or in the free list
+    int32_t next_name;   // Next entry in the same username bucket
+    uint8_t named;       // Whether the entry is in a username bucket
+    uint8_t referenced;  // CLOCK bit, set by hits
+} CacheEntry;
+
+// An entry plus its share of the two bucket arrays, which are sized up to
+// twice the entry count
+#define ENTRY_COST (sizeof(CacheEntry) + 4 * sizeof(int32_t))
+
+static CacheEntry *entries = NULL;
+static int32_t *id_buckets = NULL;
+static int32_t *name_buckets = NULL;
+static size_t capacity = 0;
+static size_t bucket_mask = 0;
+static size_t used = 0;
+static size_t hand = 0;           // CLOCK hand
+static int32_t free_list = NO_ENTRY;
+static size_t budget = STUDENT_CACHE_DEFAULT_BUDGET;
+static unsigned epoch = 0;        // student_store_epoch() the entries belong to
+static StudentCacheStats counters;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t hash_id(int id) {
+    uint32_t h = (uint32_t)id * 2654435761u;
+    return h ^ (h >> 16);
+}
+
+// FNV-1a
+static uint32_t hash_username(const char *username) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *c = (const unsigned char*)username; *c; c++) {
+        h = (h ^ *c) * 16777619u;
+    }
+    return h;
+}
+
+static void reset_entries(void) {
+    for (size_t i = 0; i <= bucket_mask && id_buckets; i++) {
+        id_buckets[i] = NO_ENTRY;
+        name_buckets[i] = NO_ENTRY;
+    }
+    free_list = NO_ENTRY;
+    for (size_t i = capacity; i-- > 0;) {
+        entries[i].recno = NO_ENTRY;
+        entries[i].next_id = free_list;
+        free_list = (int32_t)i;
+    }
+    used = 0;
+    hand = 0;
+}
+
+static void free_tables(void) {
+    free(entries);
+    free(id_buckets);
+    free(name_buckets);
+    entries = NULL;
+    id_buckets = name_buckets = NULL;
+    capacity = bucket_mask = used = 0;
+    free_list = NO_ENTRY;
+}
+
+static bool ensure_tables(void) {
+    if (entries) return true;
+
+    size_t count = budget / ENTRY_COST;
+    if (count == 0) return false;
+    size_t buckets = 1;
+    while (buckets < count) buckets <<= 1;
+
+    entries = malloc(count * sizeof(CacheEntry));
+    id_buckets = malloc(buckets * sizeof(int32_t));
+    name_buckets = malloc(buckets * sizeof(int32_t));
+    if (!entries || !id_buckets || !name_buckets) {
+        free_tables();
+        log_message(LOG_ERROR, "Memory allocation failed for student cache");
+        return false;
+    }
+    capacity = count;
+    bucket_mask = buckets - 1;
+    reset_entries();
+    return true;
+}
+
+// Entries are record numbers into one particular mapped file; drop them
+// all once a different one is mapped. False if nothing can be cached.
+static bool sync_epoch(void) {
+    unsigned now = student_store_epoch();
+    if (now != epoch) {
+        if (entries) reset_entries();
+        epoch = now;
+    }
+    return now != 0 && entries;
+}
+
+static int32_t find_id(int student_id) {
+    int32_t e = id_buckets[hash_id(student_id) & bucket_mask];
+    while (e != NO_ENTRY && entries[e].id != student_id) e = entries[e].next_id;
+    return e;
+}
+
+static void remove_entry(int32_t e) {
+    int32_t *link = &id_buckets[hash_id(entries[e].id) & bucket_mask];
+    while (*link != e) link = &entries[*link].next_id;
+    *link = entries[e].next_id;
+
+    if (entries[e].named) {
+        link = &name_buckets[entries[e].name_hash & bucket_mask];
+        while (*link != e) link = &entries[*link].next_name;
+        *link = entries[e].next_name;
+    }
+
+    entries[e].recno = NO_ENTRY;
+    entries[e].next_id = free_list;
+    free_list = e;
+    used--;
+}
+
+// Sweep the hand past recently hit entries and evict the first cold one
+static int32_t evict(void) {
+    for (;;) {
+        int32_t e = (int32_t)hand;
+        hand = (hand + 1) % capacity;
+        if (entries[e].recno == NO_ENTRY) continue;
+        if (entries[e].referenced) {
+            entries[e].referenced = 0;
+            continue;
+        }
+        remove_entry(e);
+        counters.evictions++;
+        return e;
+    }
+}
+
+// Resize the cache; a budget of 0 turns it off
+void student_cache_set_budget(size_t bytes) {
+    pthread_mutex_lock(&cache_lock);
+    free_tables();
+    budget = bytes;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+const Student* student_cache_get(int student_id) {
+    pthread_mutex_lock(&cache_lock);
+    const Student *found = NULL;
+    if (sync_epoch()) {
+        int32_t e = find_id(student_id);
+        if (e != NO_ENTRY) {
+            const Student *s = student_store_at((size_t)entries[e].recno);
+            if (s && s->id == student_id) {
+                entries[e].referenced = 1;
+                found = s;
+            }
+        }
+    }
+    if (found) {
+        counters.hits++;
+    } else {
+        counters.misses++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return found;
+}
+
+const Student* student_cache_get_by_username(const char *username) {
+    if (!username || !*username) return NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    const Student *found = NULL;
+    if (sync_epoch()) {
+        uint32_t h = hash_username(username);
+        for (int32_t e = name_buckets[h & bucket_mask]; e != NO_ENTRY; e = entries[e].next_name) {
+            if (entries[e].name_hash != h) continue;
+            // Another process may have renamed the account; keep looking
+            const Student *s = student_store_at((size_t)entries[e].recno);
+            if (s && strcmp(s->username, username) == 0) {
+                entries[e].referenced = 1;
+                found = s;
+                break;
+            }
+        }
+    }
+    if (found) {
+        counters.hits++;
+    } else {
+        counters.misses++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return found;
+}
+
+// Remember where student lives, under its ID and (if it has one) username
+void student_cache_put(long recno, const Student *student) {
+    if (!student || recno < 0 || recno > INT32_MAX) return;
+
+    pthread_mutex_lock(&cache_lock);
+    if (budget > 0 && ensure_tables() && sync_epoch()) {
+        int32_t e = find_id(student->id);
+        if (e != NO_ENTRY) remove_entry(e);
+
+        if (free_list != NO_ENTRY) {
+            e = free_list;
+            free_list = entries[e].next_id;
+        } else {
+            e = evict();
+            free_list = entries[e].next_id;  // evict() pushed it on the free list
+        }
+
+        CacheEntry *c = &entries[e];
+        c->id = student->id;
+        c->recno = (int32_t)recno;
+        c->referenced = 0;
+        uint32_t bucket = hash_id(student->id) & bucket_mask;
+        c->next_id = id_buckets[bucket];
+        id_buckets[bucket] = e;
+
+        c->named = student->username[0] != '\0';
+        if (c->named) {
+            c->name_hash = hash_username(student->username);
+            c->next_name = name_buckets[c->name_hash & bucket_mask];
+            name_buckets[c->name_hash & bucket_mask] = e;
+        }
+        used++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// Drop a student's entry, e.g. after its record was rewritten
+void student_cache_forget(int student_id) {
+    pthread_mutex_lock(&cache_lock);
+    if (entries) {
+        int32_t e = find_id(student_id);
+        if (e != NO_ENTRY) remove_entry(e);
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void student_cache_clear(void) {
+    pthread_mutex_lock(&cache_lock);
+    if (entries) reset_entries();
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void student_cache_stats(StudentCacheStats *stats) {
+    if (!stats) return;
+    pthread_mutex_lock(&cache_lock);
+    *stats = counters;
+    stats->entries = used;
+    stats->capacity = entries ? capacity : budget / ENTRY_COST;
+    pthread_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,205 @@
+#include "../include/student.h"
+#include "../include/qr.h"
+#include "../include/logger.h"
+#include <stdarg.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define CARD_MAX_THREADS 16
+#define CARD_BATCH 64              // Cards a worker renders before writing
+#define CARD_MAX_BYTES 32768       // Upper bound on one rendered card
+#define CARD_QR_UNITS 220          // QR side on the card, in 0.1 mm
+
+// Cards are CR80 (85.6 x 54 mm) SVGs in 0.1 mm units, one per file in
+// ID_CARD_DIR named by student ID.
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} CardBuffer;
+
+typedef struct {
+    const Student **students;
+    int count;
+    int next;                  // Next student to hand out
+    int written;
+    int failed;
+    const char *institution;
+    pthread_mutex_t lock;
+} CardJob;
+
+static void card_printf(CardBuffer *out, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(out->buf + out->len, out->cap - out->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) out->len += (size_t)n < out->cap - out->len ? (size_t)n : out->cap - out->len - 1;
+}
+
+// Copy s into out with XML special characters escaped
+static const char* xml_escape(const char *s, size_t max, char *out, size_t size) {
+    size_t n = 0;
+    for (size_t i = 0; i < max && s[i] && n + 7 < size; i++) {
+        const char *rep = NULL;
+        switch (s[i]) {
+            case '&': rep = "&amp;"; break;
+            case '<': rep = "&lt;"; break;
+            case '>': rep = "&gt;"; break;
+            case '"': rep = "&quot;"; break;
+            case '\'': rep = "&apos;"; break;
+        }
+        if (rep) {
+            size_t len = strlen(rep);
+            memcpy(out + n, rep, len);
+            n += len;
+        } else {
+            out[n++] = s[i];
+        }
+    }
+    out[n] = '\0';
+    return out;
+}
+
+#define XML(field, buf) xml_escape((field), sizeof(field), (buf), sizeof(buf))
+
+static bool render_card(const Student *s, const char *institution, QrCode *qr, CardBuffer *out) {
+    char payload[MAX_QR_DATA];
+    format_qr_payload(s, payload, sizeof(payload));
+    if (!qr_encode(payload, qr)) return false;
+
+    char name[MAX_NAME * 6], school[100 * 6], grade[10 * 6], section[10 * 6], inst[100 * 6];
+    int dim = qr->size + 2 * QR_QUIET_ZONE;
+
+    card_printf(out, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"85.6mm\" height=\"54mm\" "
+                     "viewBox=\"0 0 856 540\" font-family=\"sans-serif\">\n");
+    card_printf(out, "<rect width=\"856\" height=\"540\" rx=\"30\" fill=\"#fff\" stroke=\"#333\" stroke-width=\"4\"/>\n");
+    card_printf(out, "<rect x=\"2\" y=\"2\" width=\"852\" height=\"96\" rx=\"28\" fill=\"#1f3b73\"/>\n");
+    card_printf(out, "<text x=\"40\" y=\"64\" font-size=\"40\" fill=\"#fff\">%s</text>\n",
+                xml_escape(institution, 100, inst, sizeof(inst)));
+    card_printf(out, "<text x=\"40\" y=\"170\" font-size=\"44\" font-weight=\"bold\">%s</text>\n",
+                XML(s->name, name));
+    card_printf(out, "<text x=\"40\" y=\"240\" font-size=\"32\">ID: %d</text>\n", s->id);
+    card_printf(out, "<text x=\"40\" y=\"290\" font-size=\"32\">Grade %s  Section %s</text>\n",
+                XML(s->grade, grade), XML(s->section, section));
+    card_printf(out, "<text x=\"40\" y=\"340\" font-size=\"28\">%s</text>\n", XML(s->school, school));
+    card_printf(out, "<g transform=\"translate(600 280) scale(%.4f)\" shape-rendering=\"crispEdges\">",
+                (double)CARD_QR_UNITS / dim);
+    card_printf(out, "<rect width=\"%d\" height=\"%d\" fill=\"#fff\"/><path d=\"", dim, dim);
+    int path_len = qr_svg_path(qr, out->buf + out->len, out->cap - out->len);
+    if ((size_t)path_len >= out->cap - out->len) return false;
+    out->len += (size_t)path_len;
+    card_printf(out, "\"/></g>\n</svg>\n");
+    return out->len + 1 < out->cap;
+}
+
+static bool write_card(int id, const char *data, size_t len) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%d.svg", ID_CARD_DIR, id);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = write(fd, data, len) == (ssize_t)len;
+    return (close(fd) == 0) && ok;
+}
+
+// Workers claim batches of students, render the whole batch into memory
+// and then write its files in one burst
+static void* card_worker(void *arg) {
+    CardJob *job = arg;
+    CardBuffer out = { malloc(CARD_BATCH * CARD_MAX_BYTES), 0, 0 };
+    QrCode *qr = malloc(sizeof(QrCode));
+    size_t ends[CARD_BATCH];
+    int written = 0, failed = 0;
+
+    while (out.buf && qr) {
+        pthread_mutex_lock(&job->lock);
+        int start = job->next;
+        int n = job->count - start < CARD_BATCH ? job->count - start : CARD_BATCH;
+        job->next += n;
+        pthread_mutex_unlock(&job->lock);
+        if (n <= 0) break;
+
+        out.len = 0;
+        for (int i = 0; i < n; i++) {
+            size_t begin = out.len;
+            out.cap = begin + CARD_MAX_BYTES;
+            if (!render_card(job->students[start + i], job->institution, qr, &out)) {
+                out.len = begin;  // Drop the partial card
+            }
+            ends[i] = out.len;
+        }
+
+        size_t begin = 0;
+        for (int i = 0; i < n; i++) {
+            const Student *s = job->students[start + i];
+            if (ends[i] > begin && write_card(s->id, out.buf + begin, ends[i] - begin)) {
+                written++;
+            } else {
+                failed++;
+            }
+            begin = ends[i];
+        }
+    }
+
+    free(out.buf);
+    free(qr);
+    pthread_mutex_lock(&job->lock);
+    job->written += written;
+    job->failed += failed;
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+static int run_card_job(const Student **students, int count) {
+    SystemConfig config = load_system_config();
+    CardJob job = { students, count, 0, 0, 0, config.institution_name, PTHREAD_MUTEX_INITIALIZER };
+    ensure_dir_exists(ID_CARD_DIR);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 1;
+    if (threads > CARD_MAX_THREADS) threads = CARD_MAX_THREADS;
+    int by_size = (count + CARD_BATCH - 1) / CARD_BATCH;
+    if (threads > by_size) threads = by_size > 0 ? by_size : 1;
+
+    pthread_t tids[CARD_MAX_THREADS];
+    int started_threads = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, card_worker, &job) != 0) break;
+        started_threads = i;
+    }
+    card_worker(&job);
+    for (int i = 1; i <= started_threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    if (job.failed > 0) {
+        log_message(LOG_ERROR, "Failed to generate %d ID card(s)", job.failed);
+    }
+    return job.written;
+}
+
+bool generate_student_id_card(const Student *student) {
+    if (!student) return false;
+    return run_card_job(&student, 1) == 1;
+}
+
+// Render ID cards for every active student in grade (all grades if NULL).
+// Returns the number of cards written.
+int generate_id_cards(const char *grade) {
+    int count = 0;
+    const Student **students = filter_students(grade, NULL, 1, &count);
+    if (!students) return 0;
+
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    int written = run_card_job(students, count);
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    free(students);
+
+    double seconds = (double)(finished.tv_sec - started.tv_sec) +
+                     (double)(finished.tv_nsec - started.tv_nsec) / 1e9;
+    printf("\n\t\tGenerated %d of %d ID card(s) in %s/ (%.2f s)", written, count, ID_CARD_DIR, seconds);
+    log_message(LOG_INFO, "Generated %d ID cards for %s", written, grade ? grade : "all grades");
+    return written;
+}
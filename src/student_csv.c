@@ -0,0 +1,718 @@
+#include "../include/student.h"
+#include "../include/student_store.h"
+#include "../include/student_index.h"
+#include "../include/student_name_index.h"
+#include "../include/student_filter_index.h"
+#include "../include/student_text_index.h"
+#include "../include/student_wal.h"
+#include "../include/input_utils.h"
+#include "../include/logger.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#define CSV_MAX_COLUMNS 32
+#define CSV_MAX_THREADS 16
+#define CSV_MIN_CHUNK (256 * 1024)  // Don't split smaller inputs further
+
+typedef enum {
+    CSV_INT,
+    CSV_TEXT,
+    CSV_BOOL,
+    CSV_TIME
+} CsvKind;
+
+typedef struct {
+    const char *name;
+    CsvKind kind;
+    size_t offset;
+    size_t size;
+} CsvColumn;
+
+#define TEXT_COLUMN(field) { #field, CSV_TEXT, offsetof(Student, field), sizeof(((Student*)0)->field) }
+
+// Every Student field that can appear in a CSV file, in export order
+static const CsvColumn csv_columns[] = {
+    { "id", CSV_INT, offsetof(Student, id), sizeof(int) },
+    TEXT_COLUMN(username),
+    TEXT_COLUMN(password),
+    TEXT_COLUMN(name),
+    TEXT_COLUMN(email),
+    TEXT_COLUMN(phone),
+    TEXT_COLUMN(address),
+    TEXT_COLUMN(gender),
+    TEXT_COLUMN(dob),
+    TEXT_COLUMN(parent_name),
+    TEXT_COLUMN(parent_phone),
+    TEXT_COLUMN(parent_email),
+    TEXT_COLUMN(parent_relation),
+    TEXT_COLUMN(education),
+    TEXT_COLUMN(school),
+    TEXT_COLUMN(grade),
+    TEXT_COLUMN(section),
+    { "is_active", CSV_BOOL, offsetof(Student, is_active), sizeof(bool) },
+    { "created_at", CSV_TIME, offsetof(Student, created_at), sizeof(time_t) },
+    { "updated_at", CSV_TIME, offsetof(Student, updated_at), sizeof(time_t) },
+    { "created_by", CSV_INT, offsetof(Student, created_by), sizeof(int) },
+};
+#define CSV_COLUMN_COUNT ((int)(sizeof(csv_columns) / sizeof(csv_columns[0])))
+
+static const CsvColumn* find_column(const char *name, size_t len) {
+    for (int i = 0; i < CSV_COLUMN_COUNT; i++) {
+        if (strlen(csv_columns[i].name) == len && strncasecmp(csv_columns[i].name, name, len) == 0) {
+            return &csv_columns[i];
+        }
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Import
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    REJECT_FORMAT,
+    REJECT_ID,
+    REJECT_NAME,
+    REJECT_EMAIL,
+    REJECT_PHONE,
+    REJECT_DUPLICATE,
+    REJECT_REASONS
+} RejectReason;
+
+static const char *reject_names[REJECT_REASONS] = {
+    "Malformed row",
+    "Missing or invalid ID",
+    "Missing name",
+    "Invalid email",
+    "Invalid phone",
+    "Duplicate ID"
+};
+
+typedef struct {
+    // Input
+    const char *begin;
+    const char *end;
+    const CsvColumn **layout;  // Column for each CSV field, NULL to ignore
+    int field_count;
+    // Output
+    Student *rows;
+    size_t count;
+    size_t capacity;
+    size_t rejects[REJECT_REASONS];
+} ImportChunk;
+
+// Split one field off the front of a row, unquoting into buf. Returns a
+// pointer past the separator, or NULL at the end of the row.
+static const char* next_field(const char *p, const char *end, char *buf, size_t size,
+                              size_t *len, bool *malformed) {
+    size_t n = 0;
+    if (p < end && *p == '"') {
+        p++;
+        while (p < end) {
+            if (*p == '"') {
+                if (p + 1 < end && p[1] == '"') {
+                    if (n + 1 < size) buf[n++] = '"';
+                    p += 2;
+                    continue;
+                }
+                p++;
+                break;
+            }
+            if (n + 1 < size) buf[n++] = *p;
+            p++;
+        }
+        if (p < end && *p != ',') *malformed = true;
+    } else {
+        while (p < end && *p != ',') {
+            if (n + 1 < size) buf[n++] = *p;
+            p++;
+        }
+    }
+    buf[n] = '\0';
+    *len = n;
+    return (p < end) ? p + 1 : NULL;
+}
+
+// Whether [p, end) holds an odd number of quotes. A "" escape counts
+// twice, so the parity says whether end falls inside a quoted field.
+static bool odd_quotes(const char *p, const char *end) {
+    bool odd = false;
+    while (p < end && (p = memchr(p, '"', (size_t)(end - p)))) {
+        odd = !odd;
+        p++;
+    }
+    return odd;
+}
+
+// The newline ending the row that p is in, or NULL if it runs to end.
+// in_quotes says whether p itself is inside a quoted field; newlines in
+// quoted fields are part of the value.
+static const char* find_row_end(const char *p, const char *end, bool in_quotes) {
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) return NULL;
+        in_quotes ^= odd_quotes(p, eol);
+        if (!in_quotes) return eol;
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+static bool parse_int(const char *s, int *out) {
+    if (!*s) return false;
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (*end != '\0' || v < INT32_MIN || v > INT32_MAX) return false;
+    *out = (int)v;
+    return true;
+}
+
+static void store_field(Student *s, const CsvColumn *col, const char *value) {
+    char *dst = (char*)s + col->offset;
+    switch (col->kind) {
+        case CSV_TEXT:
+            strncpy(dst, value, col->size - 1);
+            dst[col->size - 1] = '\0';
+            break;
+        case CSV_BOOL:
+            *(bool*)dst = (strcmp(value, "1") == 0 || strcasecmp(value, "true") == 0 ||
+                           strcasecmp(value, "yes") == 0 || strcasecmp(value, "active") == 0);
+            break;
+        case CSV_INT: {
+            int v;
+            if (parse_int(value, &v)) *(int*)dst = v;
+            break;
+        }
+        case CSV_TIME:
+            // Timestamps are assigned on import
+            break;
+    }
+}
+
+// Parse and validate one row into s; returns REJECT_REASONS if accepted
+static RejectReason parse_row(ImportChunk *chunk, const char *p, const char *end, Student *s) {
+    memset(s, 0, sizeof(*s));
+    s->id = -1;
+    s->is_active = true;
+
+    char buf[MAX_ADDRESS + 1];
+    bool malformed = false;
+    int field = 0;
+
+    while (p) {
+        size_t len;
+        p = next_field(p, end, buf, sizeof(buf), &len, &malformed);
+        if (field < chunk->field_count && chunk->layout[field]) {
+            const CsvColumn *col = chunk->layout[field];
+            if (col->offset == offsetof(Student, id)) {
+                if (!parse_int(buf, &s->id) || s->id <= 0) return REJECT_ID;
+            } else {
+                store_field(s, col, buf);
+            }
+        }
+        field++;
+    }
+
+    if (malformed || field != chunk->field_count) return REJECT_FORMAT;
+    if (s->id <= 0) return REJECT_ID;
+    if (s->name[0] == '\0') return REJECT_NAME;
+    if (s->email[0] && !validate_email(s->email)) return REJECT_EMAIL;
+    if (s->phone[0] && !validate_phone(s->phone)) return REJECT_PHONE;
+    if (s->parent_email[0] && !validate_email(s->parent_email)) return REJECT_EMAIL;
+    if (s->parent_phone[0] && !validate_phone(s->parent_phone)) return REJECT_PHONE;
+    return REJECT_REASONS;
+}
+
+static void* import_worker(void *arg) {
+    ImportChunk *chunk = arg;
+    const char *p = chunk->begin;
+
+    while (p < chunk->end) {
+        const char *eol = find_row_end(p, chunk->end, false);
+        const char *row_end = eol ? eol : chunk->end;
+        const char *next = eol ? eol + 1 : chunk->end;
+        if (row_end > p && row_end[-1] == '\r') row_end--;
+
+        if (row_end > p) {
+            if (chunk->count == chunk->capacity) {
+                size_t cap = chunk->capacity ? chunk->capacity * 2 : 1024;
+                Student *grown = realloc(chunk->rows, cap * sizeof(Student));
+                if (!grown) {
+                    chunk->rejects[REJECT_FORMAT]++;
+                    p = next;
+                    continue;
+                }
+                chunk->rows = grown;
+                chunk->capacity = cap;
+            }
+
+            RejectReason reason = parse_row(chunk, p, row_end, &chunk->rows[chunk->count]);
+            if (reason == REJECT_REASONS) {
+                chunk->count++;
+            } else {
+                chunk->rejects[reason]++;
+            }
+        }
+        p = next;
+    }
+    return NULL;
+}
+
+// Open-addressing set of student IDs used for duplicate detection
+typedef struct {
+    int *slots;
+    size_t capacity;
+} IdSet;
+
+static bool id_set_init(IdSet *set, size_t expected) {
+    set->capacity = 1024;
+    while (set->capacity < expected * 2) set->capacity <<= 1;
+    set->slots = malloc(set->capacity * sizeof(int));
+    if (!set->slots) return false;
+    // IDs are positive, so 0 marks an empty slot
+    memset(set->slots, 0, set->capacity * sizeof(int));
+    return true;
+}
+
+// Returns false if id was already present
+static bool id_set_add(IdSet *set, int id) {
+    size_t i = ((uint32_t)id * 2654435761u) & (set->capacity - 1);
+    while (set->slots[i] != 0) {
+        if (set->slots[i] == id) return false;
+        i = (i + 1) & (set->capacity - 1);
+    }
+    set->slots[i] = id;
+    return true;
+}
+
+static int import_thread_count(size_t bytes) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 1;
+    if (threads > CSV_MAX_THREADS) threads = CSV_MAX_THREADS;
+    int by_size = (int)(bytes / CSV_MIN_CHUNK) + 1;
+    return threads < by_size ? threads : by_size;
+}
+
+// Bulk-load students from a CSV file whose first row names the columns.
+// Rows are parsed and validated in parallel, checked for duplicate IDs and
+// appended to STUDENT_FILE in one write, followed by one index rebuild.
+bool import_students_from_csv(const char *filename) {
+    if (!filename) return false;
+
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        log_message(LOG_ERROR, "Failed to open CSV file for import: %s", filename);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        log_message(LOG_ERROR, "Failed to map CSV file for import: %s", filename);
+        return false;
+    }
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+    const char *end = data + size;
+
+    // Header row: map each field to a Student column
+    const char *header_end = find_row_end(data, end, false);
+    const char *body = header_end ? header_end + 1 : end;
+    if (!header_end) header_end = end;
+    if (header_end > data && header_end[-1] == '\r') header_end--;
+
+    const CsvColumn *layout[CSV_MAX_COLUMNS];
+    int field_count = 0;
+    bool has_id = false, has_name = false;
+    for (const char *p = data; p && field_count < CSV_MAX_COLUMNS; field_count++) {
+        char name[64];
+        size_t len;
+        bool malformed = false;
+        p = next_field(p, header_end, name, sizeof(name), &len, &malformed);
+        layout[field_count] = find_column(name, len);
+        if (layout[field_count] && strcmp(layout[field_count]->name, "id") == 0) has_id = true;
+        if (layout[field_count] && strcmp(layout[field_count]->name, "name") == 0) has_name = true;
+    }
+    if (!has_id || !has_name) {
+        log_message(LOG_ERROR, "CSV import needs at least 'id' and 'name' columns");
+        munmap((void*)data, size);
+        return false;
+    }
+
+    // Split the body into chunks that start and end on row boundaries. The
+    // quotes before each split point say whether it is inside a field.
+    int threads = import_thread_count((size_t)(end - body));
+    ImportChunk chunks[CSV_MAX_THREADS];
+    pthread_t tids[CSV_MAX_THREADS];
+    const char *p = body;
+    for (int i = 0; i < threads; i++) {
+        memset(&chunks[i], 0, sizeof(ImportChunk));
+        chunks[i].layout = layout;
+        chunks[i].field_count = field_count;
+        chunks[i].begin = p;
+
+        const char *split = (i == threads - 1) ? end : p + (size_t)(end - body) / threads;
+        if (split < p) split = p;
+        if (split < end) {
+            const char *eol = find_row_end(split, end, odd_quotes(p, split));
+            split = eol ? eol + 1 : end;
+        }
+        chunks[i].end = split;
+        p = split;
+    }
+
+    int started_threads = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, import_worker, &chunks[i]) != 0) break;
+        started_threads = i;
+    }
+    import_worker(&chunks[0]);
+    for (int i = 1; i <= started_threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    // Any chunk whose thread failed to start is parsed here
+    for (int i = started_threads + 1; i < threads; i++) {
+        import_worker(&chunks[i]);
+    }
+    munmap((void*)data, size);
+
+    // Duplicate check against existing students and earlier rows, in file
+    // order, compacting each chunk's accepted rows in place
+    size_t parsed = 0;
+    for (int i = 0; i < threads; i++) parsed += chunks[i].count;
+
+    // Hold the writer lock from the duplicate check to the append, so
+    // students added meanwhile by other terminals are seen
+    bool locked = student_store_lock();
+    size_t existing = student_store_count();
+    IdSet ids = { NULL, 0 };
+    bool ok = locked && id_set_init(&ids, existing + parsed);
+    if (locked && !ok) log_message(LOG_ERROR, "Memory allocation failed for CSV import");
+
+    for (size_t r = 0; ok && r < existing; r++) {
+        id_set_add(&ids, student_store_summary(r)->id);
+    }
+
+    time_t now = time(NULL);
+    size_t accepted = 0;
+    for (int i = 0; ok && i < threads; i++) {
+        size_t kept = 0;
+        for (size_t r = 0; r < chunks[i].count; r++) {
+            Student *s = &chunks[i].rows[r];
+            if (!id_set_add(&ids, s->id)) {
+                chunks[i].rejects[REJECT_DUPLICATE]++;
+                continue;
+            }
+            s->created_at = now;
+            s->updated_at = now;
+            s->created_by = current_user.ID;
+            if (kept != r) chunks[i].rows[kept] = *s;
+            kept++;
+        }
+        chunks[i].count = kept;
+        accepted += kept;
+    }
+    free(ids.slots);
+
+    // One sequential append of every accepted row. The bulk write is synced
+    // directly, so bring the journal to a clean checkpoint first.
+    if (ok && accepted > 0) {
+        student_wal_checkpoint();
+        int out = open(STUDENT_FILE, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        struct iovec iov[CSV_MAX_THREADS];
+        int iovcnt = 0;
+        size_t bytes = 0;
+        for (int i = 0; i < threads; i++) {
+            if (chunks[i].count == 0) continue;
+            iov[iovcnt].iov_base = chunks[i].rows;
+            iov[iovcnt].iov_len = chunks[i].count * sizeof(Student);
+            bytes += iov[iovcnt].iov_len;
+            iovcnt++;
+        }
+
+        size_t written = 0;
+        while (out >= 0 && written < bytes) {
+            ssize_t n = writev(out, iov, iovcnt);
+            if (n <= 0) break;
+            written += (size_t)n;
+            // Advance the iovecs past what was written
+            size_t skip = (size_t)n;
+            while (iovcnt > 0 && skip >= iov[0].iov_len) {
+                skip -= iov[0].iov_len;
+                memmove(iov, iov + 1, (size_t)(--iovcnt) * sizeof(struct iovec));
+            }
+            if (iovcnt > 0) {
+                iov[0].iov_base = (char*)iov[0].iov_base + skip;
+                iov[0].iov_len -= skip;
+            }
+        }
+
+        ok = out >= 0 && written == bytes && fsync(out) == 0;
+        if (out >= 0) close(out);
+        if (!ok) {
+            log_message(LOG_ERROR, "Failed to append imported students to %s", STUDENT_FILE);
+        }
+    }
+
+    size_t rejects[REJECT_REASONS] = {0};
+    size_t total_rejects = 0;
+    for (int i = 0; i < threads; i++) {
+        for (int r = 0; r < REJECT_REASONS; r++) {
+            rejects[r] += chunks[i].rejects[r];
+            total_rejects += chunks[i].rejects[r];
+        }
+        free(chunks[i].rows);
+    }
+
+    // One rebuild for the whole batch instead of per-row maintenance
+    if (ok && accepted > 0) {
+        student_store_refresh();  // Recounts the file header
+        student_index_rebuild();
+        student_name_index_invalidate();
+        student_filter_index_invalidate();
+        student_text_index_invalidate();
+    }
+    if (locked) student_store_unlock();
+
+    struct timespec finished;
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double seconds = (double)(finished.tv_sec - started.tv_sec) +
+                     (double)(finished.tv_nsec - started.tv_nsec) / 1e9;
+    size_t rows = accepted + total_rejects;
+    double rate = seconds > 0 ? (double)rows / seconds : (double)rows;
+
+    printf("\n\t\tImported %zu of %zu rows in %.2f s (%.0f rows/s, %d threads)",
+           accepted, rows, seconds, rate, threads);
+    for (int r = 0; r < REJECT_REASONS; r++) {
+        if (rejects[r] > 0) printf("\n\t\t  %-22s %zu", reject_names[r], rejects[r]);
+    }
+    log_message(LOG_INFO, "CSV import from %s: %zu accepted, %zu rejected, %.0f rows/s",
+                filename, accepted, total_rejects, rate);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Export
+// ---------------------------------------------------------------------------
+
+#define EXPORT_READ_RECORDS 1024        // ~1 MB of Student records per read
+#define EXPORT_BUFFER_SIZE (1 << 20)    // Output is written in 1 MB blocks
+#define EXPORT_ROW_MAX 4096             // Worst-case formatted row
+
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len;
+    bool failed;
+} OutBuffer;
+
+static void out_flush(OutBuffer *out) {
+    size_t done = 0;
+    while (!out->failed && done < out->len) {
+        ssize_t n = write(out->fd, out->buf + done, out->len - done);
+        if (n <= 0) out->failed = true; else done += (size_t)n;
+    }
+    out->len = 0;
+}
+
+static inline void out_char(OutBuffer *out, char c) {
+    out->buf[out->len++] = c;
+}
+
+static void out_uint(OutBuffer *out, unsigned long long v, int min_digits) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n < min_digits) tmp[n++] = '0';
+    while (n) out->buf[out->len++] = tmp[--n];
+}
+
+static void out_int(OutBuffer *out, long long v) {
+    if (v < 0) {
+        out_char(out, '-');
+        out_uint(out, (unsigned long long)(-(v + 1)) + 1, 1);
+    } else {
+        out_uint(out, (unsigned long long)v, 1);
+    }
+}
+
+// Quote only when the value contains a separator, quote or line break
+static void out_text(OutBuffer *out, const char *s, size_t max) {
+    size_t len = strnlen(s, max);
+    if (strcspn(s, ",\"\r\n") >= len) {
+        memcpy(out->buf + out->len, s, len);
+        out->len += len;
+        return;
+    }
+    out_char(out, '"');
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '"') out_char(out, '"');
+        out_char(out, s[i]);
+    }
+    out_char(out, '"');
+}
+
+// ISO 8601 UTC timestamp using the days-to-civil conversion, so no
+// per-row gmtime/strftime calls
+static void out_time(OutBuffer *out, time_t t) {
+    if (t <= 0) return;
+    long long days = (long long)t / 86400, secs = (long long)t % 86400;
+    long long z = days + 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    long long doe = z - era * 146097;
+    long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long long mp = (5 * doy + 2) / 153;
+    long long day = doy - (153 * mp + 2) / 5 + 1;
+    long long month = mp < 10 ? mp + 3 : mp - 9;
+    long long year = yoe + era * 400 + (month <= 2);
+
+    out_uint(out, (unsigned long long)year, 4);
+    out_char(out, '-');
+    out_uint(out, (unsigned long long)month, 2);
+    out_char(out, '-');
+    out_uint(out, (unsigned long long)day, 2);
+    out_char(out, 'T');
+    out_uint(out, (unsigned long long)(secs / 3600), 2);
+    out_char(out, ':');
+    out_uint(out, (unsigned long long)(secs / 60 % 60), 2);
+    out_char(out, ':');
+    out_uint(out, (unsigned long long)(secs % 60), 2);
+    out_char(out, 'Z');
+}
+
+static void out_field(OutBuffer *out, const Student *s, const CsvColumn *col) {
+    const char *src = (const char*)s + col->offset;
+    switch (col->kind) {
+        case CSV_INT:  out_int(out, *(const int*)src); break;
+        case CSV_TEXT: out_text(out, src, col->size); break;
+        case CSV_BOOL: out_char(out, *(const bool*)src ? '1' : '0'); break;
+        case CSV_TIME: out_time(out, *(const time_t*)src); break;
+    }
+}
+
+// Resolve a comma-separated column list; NULL selects every column except
+// the password
+static int select_columns(const char *columns, const CsvColumn **selected) {
+    int n = 0;
+    if (!columns || !*columns) {
+        for (int i = 0; i < CSV_COLUMN_COUNT; i++) {
+            if (strcmp(csv_columns[i].name, "password") != 0) selected[n++] = &csv_columns[i];
+        }
+        return n;
+    }
+
+    const char *p = columns;
+    while (*p && n < CSV_MAX_COLUMNS) {
+        while (*p == ' ') p++;
+        size_t len = strcspn(p, ", ");
+        const CsvColumn *col = find_column(p, len);
+        if (!col) {
+            log_message(LOG_WARNING, "Unknown CSV column: %.*s", (int)len, p);
+            return -1;
+        }
+        selected[n++] = col;
+        p += len;
+        while (*p == ' ' || *p == ',') p++;
+    }
+    return n;
+}
+
+// Stream students to CSV. columns is a comma-separated list (NULL for all
+// but password); grade NULL and status FILTER_ANY_STATUS (-1) export all.
+bool export_students_csv(const char *filename, const char *columns, const char *grade, int status) {
+    if (!filename) return false;
+
+    const CsvColumn *selected[CSV_MAX_COLUMNS];
+    int ncols = select_columns(columns, selected);
+    if (ncols <= 0) return false;
+
+    int in = student_store_refresh() ? open(STUDENT_FILE, O_RDONLY) : -1;
+    if (in < 0 || lseek(in, STUDENT_HEADER_SIZE, SEEK_SET) != STUDENT_HEADER_SIZE) {
+        if (in >= 0) close(in);
+        log_message(LOG_ERROR, "Failed to open student file for export");
+        return false;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    OutBuffer out = { open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644), NULL, 0, false };
+    Student *records = malloc(EXPORT_READ_RECORDS * sizeof(Student));
+    out.buf = malloc(EXPORT_BUFFER_SIZE);
+    if (out.fd < 0 || !records || !out.buf) {
+        log_message(LOG_ERROR, "Failed to prepare CSV export to %s", filename);
+        if (out.fd >= 0) close(out.fd);
+        close(in);
+        free(records);
+        free(out.buf);
+        return false;
+    }
+
+    for (int c = 0; c < ncols; c++) {
+        if (c) out_char(&out, ',');
+        out_text(&out, selected[c]->name, strlen(selected[c]->name));
+    }
+    out_char(&out, '\n');
+
+    size_t exported = 0;
+    size_t pending = 0;  // Bytes of a partial record carried over between reads
+    for (;;) {
+        ssize_t n = read(in, (char*)records + pending, EXPORT_READ_RECORDS * sizeof(Student) - pending);
+        if (n < 0) {
+            out.failed = true;
+            break;
+        }
+        size_t bytes = pending + (size_t)n;
+        size_t count = bytes / sizeof(Student);
+
+        for (size_t r = 0; r < count; r++) {
+            const Student *s = &records[r];
+            if (status != FILTER_ANY_STATUS && s->is_active != (status != 0)) continue;
+            if (grade && strncmp(s->grade, grade, sizeof(s->grade)) != 0) continue;
+
+            if (out.len + EXPORT_ROW_MAX > EXPORT_BUFFER_SIZE) out_flush(&out);
+            for (int c = 0; c < ncols; c++) {
+                if (c) out_char(&out, ',');
+                out_field(&out, s, selected[c]);
+            }
+            out_char(&out, '\n');
+            exported++;
+        }
+
+        pending = bytes - count * sizeof(Student);
+        if (pending) memmove(records, (char*)records + count * sizeof(Student), pending);
+        if (n == 0) break;
+    }
+    out_flush(&out);
+
+    bool ok = !out.failed && close(out.fd) == 0;
+    close(in);
+    free(records);
+    free(out.buf);
+
+    if (ok) {
+        log_message(LOG_INFO, "Exported %zu students to %s", exported, filename);
+    } else {
+        log_message(LOG_ERROR, "CSV export to %s failed", filename);
+    }
+    return ok;
+}
+
+bool export_students_to_csv(const char *filename) {
+    return export_students_csv(filename, NULL, NULL, FILTER_ANY_STATUS);
+}
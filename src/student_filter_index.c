@@ -0,0 +1,305 @@
+#include "../include/student_filter_index.h"
+#include "../include/student_store.h"
+#include "../include/bitmap.h"
+#include "../include/logger.h"
+
+#define FILTER_INDEX_MAGIC 0x544c4653u  // "SFLT"
+#define FILTER_INDEX_VERSION 1
+#define FILTER_VALUE_LEN 10
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t records;
+    uint32_t grade_count;
+    uint32_t section_count;
+    StudentStoreStamp stamp;
+} FilterIndexHeader;
+
+typedef struct {
+    char value[FILTER_VALUE_LEN];
+    Bitmap bits;
+} ValueBitmap;
+
+typedef struct {
+    ValueBitmap *items;
+    uint32_t count;
+    uint32_t capacity;
+} ValueSet;
+
+static ValueSet grades = { NULL, 0, 0 };
+static ValueSet sections = { NULL, 0, 0 };
+static Bitmap active_bits;
+static Bitmap inactive_bits;
+static uint32_t record_total = 0;
+static bool loaded = false;
+static bool dirty = false;
+static uint64_t generation = 0;  // Student file generation the index reflects
+
+static void value_set_free(ValueSet *set) {
+    for (uint32_t i = 0; i < set->count; i++) {
+        bitmap_free(&set->items[i].bits);
+    }
+    free(set->items);
+    set->items = NULL;
+    set->count = set->capacity = 0;
+}
+
+static void reset_index(void) {
+    value_set_free(&grades);
+    value_set_free(&sections);
+    bitmap_free(&active_bits);
+    bitmap_free(&inactive_bits);
+    record_total = 0;
+}
+
+static Bitmap* value_set_find(ValueSet *set, const char *value) {
+    for (uint32_t i = 0; i < set->count; i++) {
+        if (strncmp(set->items[i].value, value, FILTER_VALUE_LEN) == 0) {
+            return &set->items[i].bits;
+        }
+    }
+    return NULL;
+}
+
+static Bitmap* value_set_get(ValueSet *set, const char *value) {
+    Bitmap *bits = value_set_find(set, value);
+    if (bits) return bits;
+
+    if (set->count == set->capacity) {
+        uint32_t cap = set->capacity ? set->capacity * 2 : 8;
+        ValueBitmap *grown = realloc(set->items, cap * sizeof(ValueBitmap));
+        if (!grown) return NULL;
+        set->items = grown;
+        set->capacity = cap;
+    }
+    ValueBitmap *item = &set->items[set->count++];
+    memset(item->value, 0, sizeof(item->value));
+    strncpy(item->value, value, FILTER_VALUE_LEN - 1);
+    bitmap_init(&item->bits);
+    return &item->bits;
+}
+
+static bool index_record(uint32_t recno, const char *grade, const char *section, bool is_active) {
+    Bitmap *g = value_set_get(&grades, grade);
+    Bitmap *sec = value_set_get(&sections, section);
+    return g && sec &&
+           bitmap_add(g, recno) && bitmap_add(sec, recno) &&
+           bitmap_add(is_active ? &active_bits : &inactive_bits, recno);
+}
+
+static void unindex_record(uint32_t recno, const char *grade, const char *section, bool is_active) {
+    Bitmap *g = value_set_find(&grades, grade);
+    Bitmap *sec = value_set_find(&sections, section);
+    if (g) bitmap_remove(g, recno);
+    if (sec) bitmap_remove(sec, recno);
+    bitmap_remove(is_active ? &active_bits : &inactive_bits, recno);
+}
+
+static bool rebuild_index(void) {
+    reset_index();
+    if (!student_store_refresh()) return false;
+    uint64_t built_from = student_store_header()->generation;
+
+    size_t total = student_store_count();
+    for (size_t i = 0; i < total; i++) {
+        const StudentSummary *s = student_store_summary(i);
+        if (!index_record((uint32_t)i, s->grade, s->section, s->is_active)) {
+            log_message(LOG_ERROR, "Memory allocation failed for filter index");
+            reset_index();
+            return false;
+        }
+    }
+    record_total = (uint32_t)total;
+
+    dirty = true;
+    generation = built_from;
+    log_message(LOG_INFO, "Rebuilt student filter index (%zu records)", total);
+    return true;
+}
+
+static bool read_value_set(ValueSet *set, uint32_t count, FILE *fp) {
+    for (uint32_t i = 0; i < count; i++) {
+        char value[FILTER_VALUE_LEN];
+        if (fread(value, sizeof(value), 1, fp) != 1) return false;
+        value[FILTER_VALUE_LEN - 1] = '\0';
+        Bitmap *bits = value_set_get(set, value);
+        if (!bits || !bitmap_read(bits, fp)) return false;
+    }
+    return true;
+}
+
+static bool write_value_set(const ValueSet *set, FILE *fp) {
+    for (uint32_t i = 0; i < set->count; i++) {
+        if (fwrite(set->items[i].value, FILTER_VALUE_LEN, 1, fp) != 1 ||
+            !bitmap_write(&set->items[i].bits, fp)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool load_snapshot(void) {
+    FILE *fp = fopen(STUDENT_FILTER_INDEX_FILE, "rb");
+    if (!fp) return false;
+
+    FilterIndexHeader hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+              hdr.magic == FILTER_INDEX_MAGIC && hdr.version == FILTER_INDEX_VERSION &&
+              student_store_stamp_equal(hdr.stamp, student_store_stamp());
+
+    ok = ok && read_value_set(&grades, hdr.grade_count, fp) &&
+         read_value_set(&sections, hdr.section_count, fp) &&
+         bitmap_read(&active_bits, fp) && bitmap_read(&inactive_bits, fp);
+
+    if (ok) {
+        record_total = hdr.records;
+    } else {
+        reset_index();
+    }
+    fclose(fp);
+    return ok;
+}
+
+static void save_at_exit(void) {
+    student_filter_index_save();
+}
+
+bool student_filter_index_open(void) {
+    if (loaded) return true;
+
+    static bool exit_hook = false;
+    if (!exit_hook) {
+        atexit(save_at_exit);
+        exit_hook = true;
+    }
+
+    loaded = load_snapshot() || rebuild_index();
+    return loaded;
+}
+
+bool student_filter_index_save(void) {
+    if (!loaded || !dirty) return true;
+
+    // Another process changed the student file after this index last
+    // caught up; leave the snapshot stale so the next open rebuilds
+    StudentStoreStamp stamp = student_store_stamp();
+    if ((uint64_t)stamp.generation != generation) return true;
+
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", STUDENT_FILTER_INDEX_FILE, (int)getpid());
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        log_message(LOG_ERROR, "Failed to create student filter index file");
+        return false;
+    }
+
+    FilterIndexHeader hdr = { FILTER_INDEX_MAGIC, FILTER_INDEX_VERSION, record_total,
+                              grades.count, sections.count, stamp };
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+              write_value_set(&grades, fp) && write_value_set(&sections, fp) &&
+              bitmap_write(&active_bits, fp) && bitmap_write(&inactive_bits, fp);
+
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, STUDENT_FILTER_INDEX_FILE) != 0) {
+        log_message(LOG_ERROR, "Failed to write student filter index file");
+        remove(tmp_path);
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+// Drop the in-memory index after a bulk change; it is rebuilt on next use
+void student_filter_index_invalidate(void) {
+    reset_index();
+    loaded = false;
+    dirty = false;
+}
+
+// old is NULL for a newly appended record. As with the name index, only an
+// index that is already in memory is maintained incrementally.
+void student_filter_index_update(long recno, const Student *old, const Student *updated) {
+    if (!loaded) return;
+
+    if (old) {
+        unindex_record((uint32_t)recno, old->grade, old->section, old->is_active);
+    } else if ((uint32_t)recno >= record_total) {
+        record_total = (uint32_t)recno + 1;
+    }
+    if (updated && !index_record((uint32_t)recno, updated->grade, updated->section, updated->is_active)) {
+        log_message(LOG_ERROR, "Memory allocation failed for filter index");
+        reset_index();
+        loaded = false;
+        return;
+    }
+    dirty = true;
+    generation = student_store_header()->generation;
+}
+
+static int compare_cardinality(const void *a, const void *b) {
+    uint32_t x = bitmap_cardinality(*(const Bitmap* const*)a);
+    uint32_t y = bitmap_cardinality(*(const Bitmap* const*)b);
+    return (x > y) - (x < y);
+}
+
+// Record numbers matching every given criterion, in ascending order. A NULL
+// grade or section and FILTER_ANY_STATUS leave that criterion out.
+long* student_filter_index_query(const char *grade, const char *section, int status, int *count) {
+    if (count) *count = 0;
+    if (!student_filter_index_open()) return NULL;
+
+    const Bitmap *terms[3];
+    int nterms = 0;
+    bool empty = false;
+
+    if (grade) {
+        const Bitmap *bits = value_set_find(&grades, grade);
+        if (bits) terms[nterms++] = bits; else empty = true;
+    }
+    if (section) {
+        const Bitmap *bits = value_set_find(&sections, section);
+        if (bits) terms[nterms++] = bits; else empty = true;
+    }
+    if (status != FILTER_ANY_STATUS) {
+        terms[nterms++] = status ? &active_bits : &inactive_bits;
+    }
+
+    if (empty) return calloc(1, sizeof(long));
+
+    if (nterms == 0) {
+        long *all = malloc((record_total > 0 ? record_total : 1) * sizeof(long));
+        if (!all) return NULL;
+        for (uint32_t i = 0; i < record_total; i++) all[i] = i;
+        if (count) *count = (int)record_total;
+        return all;
+    }
+
+    qsort(terms, nterms, sizeof(terms[0]), compare_cardinality);
+    Bitmap result;
+    if (!bitmap_copy(terms[0], &result)) return NULL;
+    for (int i = 1; i < nterms; i++) {
+        Bitmap next;
+        bool ok = bitmap_and(&result, terms[i], &next);
+        bitmap_free(&result);
+        if (!ok) return NULL;
+        result = next;
+    }
+
+    uint32_t n = bitmap_cardinality(&result);
+    uint32_t *values = malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+    long *recnos = malloc((n > 0 ? n : 1) * sizeof(long));
+    if (!values || !recnos) {
+        free(values);
+        free(recnos);
+        bitmap_free(&result);
+        return NULL;
+    }
+    bitmap_to_array(&result, values);
+    for (uint32_t i = 0; i < n; i++) recnos[i] = values[i];
+    free(values);
+    bitmap_free(&result);
+
+    if (count) *count = (int)n;
+    return recnos;
+}
@@ -0,0 +1,252 @@
+#include "../include/student_index.h"
+#include "../include/student.h"
+#include "../include/student_store.h"
+#include "../include/logger.h"
+#include "../include/file_lock.h"
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define INDEX_MAGIC 0x58444953u  // "SIDX"
+#define INDEX_VERSION 1
+#define INDEX_MIN_CAPACITY 1024
+#define SLOT_EMPTY (-1)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;   // Number of slots, always a power of two
+    uint32_t used;       // Occupied slots
+    int64_t records;     // Number of data records covered by the index
+} IndexHeader;
+
+typedef struct {
+    int32_t id;
+    int32_t recno;       // SLOT_EMPTY when unused
+} IndexSlot;
+
+static int index_fd = -1;
+static IndexHeader header;
+
+static uint32_t hash_id(int id, uint32_t capacity) {
+    uint32_t h = (uint32_t)id * 2654435761u;
+    h ^= h >> 16;
+    return h & (capacity - 1);
+}
+
+static off_t slot_offset(uint32_t slot) {
+    return (off_t)sizeof(IndexHeader) + (off_t)slot * sizeof(IndexSlot);
+}
+
+// Number of complete Student records currently in the data file
+static long count_data_records(void) {
+    if (!student_store_refresh()) return 0;
+    return (long)student_store_count();
+}
+
+// Place an entry into an in-memory table; returns false for duplicate IDs
+static bool table_put(IndexSlot *slots, uint32_t capacity, int id, long recno) {
+    uint32_t i = hash_id(id, capacity);
+    while (slots[i].recno != SLOT_EMPTY) {
+        if (slots[i].id == id) return false;
+        i = (i + 1) & (capacity - 1);
+    }
+    slots[i].id = id;
+    slots[i].recno = (int32_t)recno;
+    return true;
+}
+
+static IndexSlot* table_alloc(uint32_t capacity) {
+    IndexSlot *slots = malloc((size_t)capacity * sizeof(IndexSlot));
+    if (!slots) return NULL;
+    for (uint32_t i = 0; i < capacity; i++) {
+        slots[i].id = 0;
+        slots[i].recno = SLOT_EMPTY;
+    }
+    return slots;
+}
+
+// Write a complete table to a temporary file and atomically replace the index
+static bool table_write(const IndexSlot *slots, const IndexHeader *hdr) {
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", STUDENT_INDEX_FILE, (int)getpid());
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        log_message(LOG_ERROR, "Failed to create student index file");
+        return false;
+    }
+
+    bool ok = fwrite(hdr, sizeof(IndexHeader), 1, fp) == 1 &&
+              fwrite(slots, sizeof(IndexSlot), hdr->capacity, fp) == hdr->capacity;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, STUDENT_INDEX_FILE) != 0) {
+        log_message(LOG_ERROR, "Failed to write student index file");
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+static bool open_index_file(void) {
+    if (index_fd >= 0) close(index_fd);
+    index_fd = open(STUDENT_INDEX_FILE, O_RDWR);
+    if (index_fd < 0) return false;
+
+    if (pread(index_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        header.magic != INDEX_MAGIC || header.version != INDEX_VERSION ||
+        header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0) {
+        close(index_fd);
+        index_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool student_index_rebuild(void) {
+    long records = count_data_records();
+    uint32_t capacity = INDEX_MIN_CAPACITY;
+    while ((long)capacity < records * 2) capacity <<= 1;
+
+    IndexSlot *slots = table_alloc(capacity);
+    if (!slots) {
+        log_message(LOG_ERROR, "Memory allocation failed for student index");
+        return false;
+    }
+
+    IndexHeader hdr = { INDEX_MAGIC, INDEX_VERSION, capacity, 0, 0 };
+    if (student_store_refresh()) {
+        long available = (long)student_store_count();
+        if (available < records) records = available;
+        for (long recno = 0; recno < records; recno++) {
+            // Keep the first occurrence, matching the old linear-scan semantics
+            if (table_put(slots, capacity, student_store_summary(recno)->id, recno)) hdr.used++;
+        }
+        hdr.records = records;
+    }
+
+    bool ok = table_write(slots, &hdr);
+    free(slots);
+    if (ok) {
+        ok = open_index_file();
+        log_message(LOG_INFO, "Rebuilt student index (%ld records)", (long)hdr.records);
+    }
+    return ok;
+}
+
+bool student_index_open(void) {
+    if (index_fd >= 0 && header.records == count_data_records() &&
+        file_is_current(index_fd, STUDENT_INDEX_FILE)) {
+        return true;
+    }
+
+    if (open_index_file() && header.records == count_data_records()) {
+        return true;
+    }
+    // Rebuild under the writer lock so no append lands halfway through;
+    // another process may have caught the index up while we waited
+    if (!student_store_lock()) return false;
+    bool ok = (open_index_file() && header.records == count_data_records()) ||
+              student_index_rebuild();
+    student_store_unlock();
+    return ok;
+}
+
+void student_index_close(void) {
+    if (index_fd >= 0) {
+        close(index_fd);
+        index_fd = -1;
+    }
+}
+
+bool student_index_lookup(int student_id, long *recno) {
+    if (!student_index_open()) return false;
+
+    uint32_t i = hash_id(student_id, header.capacity);
+    for (uint32_t probes = 0; probes < header.capacity; probes++) {
+        IndexSlot slot;
+        if (pread(index_fd, &slot, sizeof(slot), slot_offset(i)) != (ssize_t)sizeof(slot)) {
+            return false;
+        }
+        if (slot.recno == SLOT_EMPTY) return false;
+        if (slot.id == student_id) {
+            if (recno) *recno = slot.recno;
+            return true;
+        }
+        i = (i + 1) & (header.capacity - 1);
+    }
+    return false;
+}
+
+// Double the table size, rehashing the existing slots
+static bool grow_index(void) {
+    uint32_t capacity = header.capacity * 2;
+    IndexSlot *old_slots = malloc((size_t)header.capacity * sizeof(IndexSlot));
+    IndexSlot *slots = table_alloc(capacity);
+    if (!old_slots || !slots) {
+        free(old_slots);
+        free(slots);
+        log_message(LOG_ERROR, "Memory allocation failed while growing student index");
+        return false;
+    }
+
+    size_t bytes = (size_t)header.capacity * sizeof(IndexSlot);
+    bool ok = pread(index_fd, old_slots, bytes, slot_offset(0)) == (ssize_t)bytes;
+    if (ok) {
+        for (uint32_t i = 0; i < header.capacity; i++) {
+            if (old_slots[i].recno != SLOT_EMPTY) {
+                table_put(slots, capacity, old_slots[i].id, old_slots[i].recno);
+            }
+        }
+        IndexHeader hdr = header;
+        hdr.capacity = capacity;
+        ok = table_write(slots, &hdr) && open_index_file();
+    }
+
+    free(old_slots);
+    free(slots);
+    return ok;
+}
+
+// Record that student_id lives at recno. Must be called after the record has
+// been appended, so the index never covers records that are not on disk.
+bool student_index_insert(int student_id, long recno) {
+    // Reread the header; other processes may have inserted or rebuilt
+    if (!open_index_file()) {
+        // Nothing to maintain incrementally; build from the data file instead
+        return student_index_rebuild();
+    }
+    if (header.records != recno) {
+        // The index fell behind the data file; rebuilding also covers recno
+        return student_index_rebuild();
+    }
+    if ((header.used + 1) * 2 > header.capacity && !grow_index()) {
+        return false;
+    }
+
+    uint32_t i = hash_id(student_id, header.capacity);
+    IndexSlot slot;
+    while (pread(index_fd, &slot, sizeof(slot), slot_offset(i)) == (ssize_t)sizeof(slot)) {
+        if (slot.recno == SLOT_EMPTY || slot.id == student_id) break;
+        i = (i + 1) & (header.capacity - 1);
+    }
+
+    bool is_new = (slot.recno == SLOT_EMPTY);
+    if (is_new) {
+        slot.id = student_id;
+        slot.recno = (int32_t)recno;
+        if (pwrite(index_fd, &slot, sizeof(slot), slot_offset(i)) != (ssize_t)sizeof(slot)) {
+            log_message(LOG_ERROR, "Failed to update student index");
+            return false;
+        }
+        header.used++;
+    }
+
+    header.records = recno + 1;
+    if (pwrite(index_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        log_message(LOG_ERROR, "Failed to update student index header");
+        return false;
+    }
+    return true;
+}
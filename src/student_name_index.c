@@ -0,0 +1,306 @@
+#include "../include/student_name_index.h"
+#include "../include/student_store.h"
+#include "../include/logger.h"
+#include <stdint.h>
+
+#define NAME_INDEX_MAGIC 0x4d414e53u  // "SNAM"
+#define NAME_INDEX_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t pool_len;
+    StudentStoreStamp stamp;
+} NameIndexHeader;
+
+typedef struct {
+    uint32_t key_off;   // Offset of the folded name in the pool
+    uint32_t recno;
+} NameEntry;
+
+static NameEntry *entries = NULL;
+static size_t entry_count = 0;
+static size_t entry_cap = 0;
+static char *pool = NULL;
+static size_t pool_len = 0;
+static size_t pool_cap = 0;
+static bool loaded = false;
+static bool dirty = false;
+static uint64_t generation = 0;  // Student file generation the index reflects
+
+// Lowercase, trim and collapse runs of whitespace to a single space
+void student_name_index_fold(const char *name, char *out, size_t size) {
+    if (!out || size == 0) return;
+    size_t n = 0;
+    bool pending_space = false;
+
+    for (const char *c = name ? name : ""; *c && n + 1 < size; c++) {
+        if (isspace((unsigned char)*c)) {
+            pending_space = (n > 0);
+            continue;
+        }
+        if (pending_space && n + 2 < size) out[n++] = ' ';
+        pending_space = false;
+        out[n++] = (char)tolower((unsigned char)*c);
+    }
+    out[n] = '\0';
+}
+
+static const char* entry_key(const NameEntry *e) {
+    return pool + e->key_off;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const NameEntry *x = a, *y = b;
+    int cmp = strcmp(entry_key(x), entry_key(y));
+    if (cmp != 0) return cmp;
+    return (x->recno > y->recno) - (x->recno < y->recno);
+}
+
+static void reset_index(void) {
+    free(entries);
+    free(pool);
+    entries = NULL;
+    pool = NULL;
+    entry_count = entry_cap = 0;
+    pool_len = pool_cap = 0;
+}
+
+static bool reserve_entries(size_t needed) {
+    if (needed <= entry_cap) return true;
+    size_t cap = entry_cap ? entry_cap : 1024;
+    while (cap < needed) cap *= 2;
+    NameEntry *grown = realloc(entries, cap * sizeof(NameEntry));
+    if (!grown) return false;
+    entries = grown;
+    entry_cap = cap;
+    return true;
+}
+
+// Append a folded key to the pool, returning its offset
+static bool pool_add(const char *key, uint32_t *off) {
+    size_t len = strlen(key) + 1;
+    if (pool_len + len > pool_cap) {
+        size_t cap = pool_cap ? pool_cap : 64 * 1024;
+        while (cap < pool_len + len) cap *= 2;
+        char *grown = realloc(pool, cap);
+        if (!grown) return false;
+        pool = grown;
+        pool_cap = cap;
+    }
+    memcpy(pool + pool_len, key, len);
+    *off = (uint32_t)pool_len;
+    pool_len += len;
+    return true;
+}
+
+// First entry whose key is >= key (and recno >= recno on ties)
+static size_t lower_bound(const char *key, uint32_t recno) {
+    size_t lo = 0, hi = entry_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(entry_key(&entries[mid]), key);
+        if (cmp < 0 || (cmp == 0 && entries[mid].recno < recno)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool rebuild_index(void) {
+    reset_index();
+    if (!student_store_refresh()) return false;
+    uint64_t built_from = student_store_header()->generation;
+
+    size_t total = student_store_count();
+    if (!reserve_entries(total)) {
+        log_message(LOG_ERROR, "Memory allocation failed for name index");
+        return false;
+    }
+
+    char key[MAX_NAME];
+    for (size_t i = 0; i < total; i++) {
+        student_name_index_fold(student_store_summary(i)->name, key, sizeof(key));
+        if (!pool_add(key, &entries[i].key_off)) {
+            log_message(LOG_ERROR, "Memory allocation failed for name index");
+            reset_index();
+            return false;
+        }
+        entries[i].recno = (uint32_t)i;
+    }
+    entry_count = total;
+    qsort(entries, entry_count, sizeof(NameEntry), compare_entries);
+
+    dirty = true;
+    generation = built_from;
+    log_message(LOG_INFO, "Rebuilt student name index (%zu records)", entry_count);
+    return true;
+}
+
+static bool load_snapshot(void) {
+    FILE *fp = fopen(STUDENT_NAME_INDEX_FILE, "rb");
+    if (!fp) return false;
+
+    NameIndexHeader hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+              hdr.magic == NAME_INDEX_MAGIC && hdr.version == NAME_INDEX_VERSION &&
+              student_store_stamp_equal(hdr.stamp, student_store_stamp());
+
+    if (ok) {
+        ok = reserve_entries(hdr.count) && (pool = malloc(hdr.pool_len + 1)) != NULL;
+        if (ok) {
+            pool_cap = hdr.pool_len + 1;
+            ok = fread(entries, sizeof(NameEntry), hdr.count, fp) == hdr.count &&
+                 fread(pool, 1, hdr.pool_len, fp) == hdr.pool_len;
+        }
+        if (ok) {
+            entry_count = hdr.count;
+            pool_len = hdr.pool_len;
+        } else {
+            reset_index();
+        }
+    }
+
+    fclose(fp);
+    return ok;
+}
+
+static void save_at_exit(void) {
+    student_name_index_save();
+}
+
+bool student_name_index_open(void) {
+    if (loaded) return true;
+
+    static bool exit_hook = false;
+    if (!exit_hook) {
+        atexit(save_at_exit);
+        exit_hook = true;
+    }
+
+    loaded = load_snapshot() || rebuild_index();
+    return loaded;
+}
+
+// Write the index out, compacting the key pool as we go
+bool student_name_index_save(void) {
+    if (!loaded || !dirty) return true;
+
+    // Another process changed the student file after this index last
+    // caught up; leave the snapshot stale so the next open rebuilds
+    StudentStoreStamp stamp = student_store_stamp();
+    if ((uint64_t)stamp.generation != generation) return true;
+
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", STUDENT_NAME_INDEX_FILE, (int)getpid());
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        log_message(LOG_ERROR, "Failed to create student name index file");
+        return false;
+    }
+
+    NameIndexHeader hdr = { NAME_INDEX_MAGIC, NAME_INDEX_VERSION,
+                            (uint32_t)entry_count, 0, stamp };
+    for (size_t i = 0; i < entry_count; i++) {
+        hdr.pool_len += (uint32_t)strlen(entry_key(&entries[i])) + 1;
+    }
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    uint32_t off = 0;
+    for (size_t i = 0; ok && i < entry_count; i++) {
+        NameEntry e = { off, entries[i].recno };
+        off += (uint32_t)strlen(entry_key(&entries[i])) + 1;
+        ok = fwrite(&e, sizeof(e), 1, fp) == 1;
+    }
+    for (size_t i = 0; ok && i < entry_count; i++) {
+        const char *key = entry_key(&entries[i]);
+        ok = fwrite(key, 1, strlen(key) + 1, fp) == strlen(key) + 1;
+    }
+
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, STUDENT_NAME_INDEX_FILE) != 0) {
+        log_message(LOG_ERROR, "Failed to write student name index file");
+        remove(tmp_path);
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+// Drop the in-memory index after a bulk change; it is rebuilt on next use
+void student_name_index_invalidate(void) {
+    reset_index();
+    loaded = false;
+    dirty = false;
+}
+
+// Maintenance hooks only touch an index that is already in memory; an
+// unloaded snapshot is stale after any write and gets rebuilt on open.
+void student_name_index_insert(const char *name, long recno) {
+    if (!loaded) return;
+
+    char key[MAX_NAME];
+    student_name_index_fold(name, key, sizeof(key));
+
+    NameEntry e;
+    if (!reserve_entries(entry_count + 1) || !pool_add(key, &e.key_off)) {
+        // Fall back to a full rebuild on next use
+        log_message(LOG_ERROR, "Memory allocation failed for name index");
+        student_name_index_invalidate();
+        return;
+    }
+    e.recno = (uint32_t)recno;
+
+    size_t pos = lower_bound(key, e.recno);
+    memmove(&entries[pos + 1], &entries[pos], (entry_count - pos) * sizeof(NameEntry));
+    entries[pos] = e;
+    entry_count++;
+    dirty = true;
+    generation = student_store_header()->generation;
+}
+
+void student_name_index_remove(const char *name, long recno) {
+    if (!loaded) return;
+
+    char key[MAX_NAME];
+    student_name_index_fold(name, key, sizeof(key));
+
+    size_t pos = lower_bound(key, (uint32_t)recno);
+    if (pos < entry_count && entries[pos].recno == (uint32_t)recno &&
+        strcmp(entry_key(&entries[pos]), key) == 0) {
+        memmove(&entries[pos], &entries[pos + 1], (entry_count - pos - 1) * sizeof(NameEntry));
+        entry_count--;
+        dirty = true;
+        generation = student_store_header()->generation;
+    }
+}
+
+// Record numbers of names equal to (or starting with) query, in name order
+long* student_name_index_search(const char *query, bool prefix, int *count) {
+    if (count) *count = 0;
+    if (!query || !student_name_index_open()) return NULL;
+
+    char key[MAX_NAME];
+    student_name_index_fold(query, key, sizeof(key));
+    size_t key_len = strlen(key);
+    if (key_len == 0) return NULL;
+
+    size_t first = lower_bound(key, 0);
+    size_t last = first;
+    while (last < entry_count) {
+        const char *k = entry_key(&entries[last]);
+        if (prefix ? strncmp(k, key, key_len) != 0 : strcmp(k, key) != 0) break;
+        last++;
+    }
+
+    long *recnos = malloc((last > first ? last - first : 1) * sizeof(long));
+    if (!recnos) return NULL;
+    for (size_t i = first; i < last; i++) {
+        recnos[i - first] = entries[i].recno;
+    }
+    if (count) *count = (int)(last - first);
+    return recnos;
+}
@@ -0,0 +1,598 @@
+#include "../include/student_store.h"
+#include "../include/logger.h"
+#include "../include/file_lock.h"
+#include <errno.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define STORE_MIN_MAP (1L << 20)  // Reserve at least 1 MB of address space
+
+// One read-only mapping of a fixed-width record file
+typedef struct {
+    const char *path;
+    size_t record_size;
+    size_t data_offset;  // Bytes before the first record
+    int fd;
+    ino_t ino;
+    void *base;
+    size_t len;
+    size_t count;
+    unsigned opens;      // Bumped each time a different file is mapped
+} MappedFile;
+
+static MappedFile cold = { STUDENT_FILE, sizeof(Student), STUDENT_HEADER_SIZE, -1, 0, NULL, 0, 0, 0 };
+static MappedFile hot = { STUDENT_HOT_FILE, sizeof(StudentSummary), 0, -1, 0, NULL, 0, 0, 0 };
+static int hot_write_fd = -1;
+static int cold_write_fd = -1;
+static ino_t checked_ino = 0;  // Student file whose format has been verified
+static int lock_fd = -1;       // Descriptor holding the writer lock
+static int lock_depth = 0;
+static pthread_t lock_owner;
+static pthread_mutex_t writer_mutex;
+static pthread_once_t writer_mutex_once = PTHREAD_ONCE_INIT;
+
+static void unmap_file(MappedFile *mf) {
+    if (mf->base) {
+        munmap(mf->base, mf->len);
+        mf->base = NULL;
+        mf->len = 0;
+    }
+}
+
+static void close_file(MappedFile *mf) {
+    unmap_file(mf);
+    if (mf->fd >= 0) {
+        close(mf->fd);
+        mf->fd = -1;
+    }
+    mf->count = 0;
+}
+
+// Map at least file_size bytes, leaving headroom so appends don't remap
+static bool map_file(MappedFile *mf, off_t file_size) {
+    unmap_file(mf);
+    if (file_size == 0) return true;
+
+    size_t len = STORE_MIN_MAP;
+    while (len < (size_t)file_size * 2) len <<= 1;
+
+    void *base = mmap(NULL, len, PROT_READ, MAP_SHARED, mf->fd, 0);
+    if (base == MAP_FAILED) {
+        log_message(LOG_ERROR, "Failed to map %s", mf->path);
+        return false;
+    }
+#ifdef MADV_WILLNEED
+    madvise(base, (size_t)file_size, MADV_WILLNEED);
+#endif
+    mf->base = base;
+    mf->len = len;
+    return true;
+}
+
+// Pick up appends and file replacement since the last call
+static bool refresh_file(MappedFile *mf) {
+    struct stat st;
+    if (stat(mf->path, &st) != 0) {
+        close_file(mf);
+        return true;
+    }
+    if (mf->fd < 0 || st.st_ino != mf->ino) {
+        close_file(mf);
+        mf->fd = open(mf->path, O_RDONLY);
+        if (mf->fd < 0 || fstat(mf->fd, &st) != 0) {
+            close_file(mf);
+            return false;
+        }
+        mf->ino = st.st_ino;
+        mf->opens++;
+        if (!map_file(mf, st.st_size)) {
+            close_file(mf);
+            return false;
+        }
+    } else if ((size_t)st.st_size > mf->len && !map_file(mf, st.st_size)) {
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    mf->count = size > mf->data_offset ? (size - mf->data_offset) / mf->record_size : 0;
+    return true;
+}
+
+static const Student* cold_records(void) {
+    return (const Student*)((const char*)cold.base + STUDENT_HEADER_SIZE);
+}
+
+static void make_summary(const Student *s, StudentSummary *out) {
+    memset(out, 0, sizeof(*out));
+    out->id = s->id;
+    memcpy(out->name, s->name, sizeof(out->name));
+    memcpy(out->grade, s->grade, sizeof(out->grade));
+    memcpy(out->section, s->section, sizeof(out->section));
+    out->is_active = s->is_active;
+}
+
+static bool open_hot_writer(void) {
+    if (hot_write_fd >= 0) {
+        // Reopen if the hot table was replaced underneath us
+        struct stat st, fst;
+        if (stat(STUDENT_HOT_FILE, &st) == 0 && fstat(hot_write_fd, &fst) == 0 &&
+            st.st_ino == fst.st_ino) {
+            return true;
+        }
+        close(hot_write_fd);
+    }
+    hot_write_fd = open(STUDENT_HOT_FILE, O_RDWR | O_CREAT, 0644);
+    if (hot_write_fd < 0) {
+        log_message(LOG_ERROR, "Failed to open student summary table");
+        return false;
+    }
+    return true;
+}
+
+static void init_header(StudentStoreHeader *h) {
+    memset(h, 0, sizeof(*h));
+    h->magic = STUDENT_STORE_MAGIC;
+    h->version = STUDENT_STORE_VERSION;
+    h->next_id = 1;
+}
+
+// Apply one record entering (sign 1) or leaving (sign -1) the totals
+static void count_record(StudentStoreHeader *h, const Student *s, int sign) {
+    if (s->is_active) h->active_count += sign;
+    if (s->id >= h->next_id) h->next_id = s->id + 1;
+
+    int slot = 0;
+    while (slot < h->grade_count && strncmp(h->grades[slot].grade, s->grade, sizeof(s->grade)) != 0) {
+        slot++;
+    }
+    if (slot == h->grade_count) {
+        if (slot == STUDENT_GRADE_SLOTS) {
+            h->grades_overflow = 1;
+            return;
+        }
+        memcpy(h->grades[slot].grade, s->grade, sizeof(s->grade));
+        h->grade_count++;
+    }
+    h->grades[slot].total += sign;
+    if (s->is_active) h->grades[slot].active += sign;
+}
+
+static bool write_header(int fd, const StudentStoreHeader *h) {
+    return pwrite(fd, h, sizeof(*h), 0) == (ssize_t)sizeof(*h);
+}
+
+// Write header plus the records keep() accepts (all if keep is NULL) to a
+// new file. The header starts from base, keeping its next_id and
+// generation, with the totals recomputed from what was written.
+static bool write_store_file(const char *path, const Student *records, size_t count,
+                             bool (*keep)(const Student *student, void *ctx), void *ctx,
+                             const StudentStoreHeader *base, size_t *kept_out) {
+    int out = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        log_message(LOG_ERROR, "Failed to create %s", path);
+        return false;
+    }
+
+    // Copy records in large blocks rather than one at a time
+    enum { BATCH = 1024 };
+    Student *batch = malloc(BATCH * sizeof(Student));
+    if (!batch) {
+        close(out);
+        unlink(path);
+        log_message(LOG_ERROR, "Memory allocation failed for student file rewrite");
+        return false;
+    }
+
+    StudentStoreHeader h;
+    init_header(&h);
+    h.next_id = base->next_id;
+    h.generation = base->generation + 1;
+
+    size_t kept = 0, pending = 0;
+    bool ok = lseek(out, STUDENT_HEADER_SIZE, SEEK_SET) == STUDENT_HEADER_SIZE;
+    for (size_t i = 0; ok && i < count; i++) {
+        if (keep && !keep(&records[i], ctx)) continue;
+        count_record(&h, &records[i], 1);
+        batch[pending++] = records[i];
+        kept++;
+        if (pending == BATCH) {
+            size_t bytes = pending * sizeof(Student);
+            ok = write(out, batch, bytes) == (ssize_t)bytes;
+            pending = 0;
+        }
+    }
+    if (ok && pending > 0) {
+        size_t bytes = pending * sizeof(Student);
+        ok = write(out, batch, bytes) == (ssize_t)bytes;
+    }
+    free(batch);
+
+    h.record_count = (int64_t)kept;
+    ok = ok && ftruncate(out, STUDENT_HEADER_SIZE + (off_t)(kept * sizeof(Student))) == 0;
+    ok = ok && write_header(out, &h);
+    ok = fsync(out) == 0 && ok;
+    ok = close(out) == 0 && ok;
+    if (!ok) {
+        unlink(path);
+        log_message(LOG_ERROR, "Failed to write %s", path);
+        return false;
+    }
+    if (kept_out) *kept_out = kept;
+    return true;
+}
+
+// Make sure STUDENT_FILE exists and starts with a header. An empty or
+// missing file gets a fresh one; a file written before headers existed is
+// rewritten with one. Checked once per inode.
+static bool ensure_store_format(void) {
+    struct stat st;
+    if (stat(STUDENT_FILE, &st) == 0 && st.st_ino == checked_ino) return true;
+
+    int fd = open(STUDENT_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        log_message(LOG_ERROR, "Failed to open student file");
+        return false;
+    }
+
+    StudentStoreHeader h;
+    bool ok = true;
+    if (pread(fd, &h, sizeof(h.magic), 0) == (ssize_t)sizeof(h.magic) && h.magic == STUDENT_STORE_RETIRED) {
+        // Opened just as a compaction swapped the file; look again
+        close(fd);
+        return ensure_store_format();
+    }
+    if (st.st_size == 0) {
+        init_header(&h);
+        ok = write_header(fd, &h) && ftruncate(fd, STUDENT_HEADER_SIZE) == 0;
+    } else if (pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+               h.magic != STUDENT_STORE_MAGIC) {
+        // Headerless file: records start at offset 0
+        size_t count = (size_t)st.st_size / sizeof(Student);
+        void *legacy = count ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+        if (count && legacy == MAP_FAILED) {
+            close(fd);
+            log_message(LOG_ERROR, "Failed to map student file for migration");
+            return false;
+        }
+        StudentStoreHeader base;
+        init_header(&base);
+        ok = write_store_file(STUDENT_FILE ".tmp", legacy, count, NULL, NULL, &base, NULL) &&
+             replace_file(STUDENT_FILE ".tmp", STUDENT_FILE);
+        if (legacy) munmap(legacy, (size_t)st.st_size);
+        if (ok) {
+            log_message(LOG_INFO, "Added header to student file (%zu records)", count);
+        }
+    } else if (h.version != STUDENT_STORE_VERSION) {
+        log_message(LOG_ERROR, "Unsupported student file version %u", h.version);
+        ok = false;
+    }
+    close(fd);
+
+    if (!ok) return false;
+    if (stat(STUDENT_FILE, &st) == 0) checked_ino = st.st_ino;
+    return true;
+}
+
+// Bring the hot table to the same length as the student file. Normally a
+// no-op; it fills in summaries after a crash between the two writes, or
+// builds the table from scratch for an existing student file.
+static bool sync_hot_table(void) {
+    if (hot.count == cold.count) return true;
+    if (!open_hot_writer()) return false;
+
+    size_t from = hot.count < cold.count ? hot.count : cold.count;
+    if (ftruncate(hot_write_fd, (off_t)(from * sizeof(StudentSummary))) != 0) {
+        log_message(LOG_ERROR, "Failed to resize student summary table");
+        return false;
+    }
+
+    // Write in large blocks rather than one summary at a time
+    enum { BATCH = 4096 };
+    StudentSummary *batch = malloc(BATCH * sizeof(StudentSummary));
+    if (!batch) {
+        log_message(LOG_ERROR, "Memory allocation failed for summary table rebuild");
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t start = from; ok && start < cold.count; start += BATCH) {
+        size_t n = cold.count - start < BATCH ? cold.count - start : BATCH;
+        for (size_t i = 0; i < n; i++) {
+            make_summary(cold_records() + start + i, &batch[i]);
+        }
+        size_t bytes = n * sizeof(StudentSummary);
+        ok = pwrite(hot_write_fd, batch, bytes, (off_t)(start * sizeof(StudentSummary))) == (ssize_t)bytes;
+    }
+    free(batch);
+
+    if (!ok) {
+        log_message(LOG_ERROR, "Failed to rebuild student summary table");
+        return false;
+    }
+    if (cold.count - from > 1) {
+        log_message(LOG_INFO, "Rebuilt student summary table (%zu records)", cold.count - from);
+    }
+    return refresh_file(&hot);
+}
+
+bool student_store_open(void) {
+    return student_store_refresh();
+}
+
+void student_store_close(void) {
+    close_file(&cold);
+    close_file(&hot);
+    if (hot_write_fd >= 0) {
+        close(hot_write_fd);
+        hot_write_fd = -1;
+    }
+    if (cold_write_fd >= 0) {
+        close(cold_write_fd);
+        cold_write_fd = -1;
+    }
+}
+
+static bool holds_writer_lock(void) {
+    return lock_depth > 0 && pthread_equal(lock_owner, pthread_self());
+}
+
+bool student_store_refresh(void) {
+    if (!ensure_store_format()) return false;
+    if (!refresh_file(&cold) || !refresh_file(&hot)) return false;
+
+    bool header_stale = cold.base && (size_t)student_store_header()->record_count != cold.count;
+    if (!header_stale && hot.count == cold.count) return true;
+
+    // Either a crash left the files out of step or another writer is between
+    // its record and header writes. Only repair under the writer lock, which
+    // waits the latter out; taking it refreshes again.
+    if (!holds_writer_lock()) {
+        if (!student_store_lock()) return false;
+        student_store_unlock();
+        return true;
+    }
+    if (header_stale && !student_store_rebuild_header()) return false;
+    return sync_hot_table();
+}
+
+// The header as currently mapped; an all-zero header if there is no file
+const StudentStoreHeader* student_store_header(void) {
+    static StudentStoreHeader empty;
+    if (!cold.base) {
+        if (empty.magic == 0) init_header(&empty);
+        return &empty;
+    }
+    return (const StudentStoreHeader*)cold.base;
+}
+
+size_t student_store_count(void) {
+    return cold.count;
+}
+
+const Student* student_store_at(size_t recno) {
+    if (recno >= cold.count) return NULL;
+    return cold_records() + recno;
+}
+
+const StudentSummary* student_store_summary(size_t recno) {
+    if (recno >= cold.count || recno >= hot.count) return NULL;
+    return (const StudentSummary*)hot.base + recno;
+}
+
+// Called after a record has been written to the student file at recno
+bool student_store_write_summary(long recno, const Student *student) {
+    if (!open_hot_writer()) return false;
+
+    StudentSummary summary;
+    make_summary(student, &summary);
+    off_t offset = (off_t)recno * (off_t)sizeof(StudentSummary);
+    if (pwrite(hot_write_fd, &summary, sizeof(summary), offset) != (ssize_t)sizeof(summary)) {
+        log_message(LOG_ERROR, "Failed to update student summary table");
+        return false;
+    }
+    return true;
+}
+
+static bool open_cold_writer(void) {
+    if (cold_write_fd >= 0) {
+        struct stat st, fst;
+        if (stat(STUDENT_FILE, &st) == 0 && fstat(cold_write_fd, &fst) == 0 &&
+            st.st_ino == fst.st_ino) {
+            return true;
+        }
+        close(cold_write_fd);
+    }
+    cold_write_fd = open(STUDENT_FILE, O_RDWR | O_CREAT, 0644);
+    if (cold_write_fd < 0) {
+        log_message(LOG_ERROR, "Failed to open student file for writing");
+        return false;
+    }
+    return true;
+}
+
+static void init_writer_mutex(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&writer_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+// Take the writer lock: a mutex against other threads, then an exclusive
+// lock on the file header, which every mutation rewrites, against other
+// processes. Nested calls from the lock holder just count. On return the
+// mapping shows every change other writers made before us.
+bool student_store_lock(void) {
+    pthread_once(&writer_mutex_once, init_writer_mutex);
+    pthread_mutex_lock(&writer_mutex);
+    if (lock_depth++ > 0) return true;
+    lock_owner = pthread_self();
+
+    bool ok = false;
+    for (;;) {
+        if (lock_fd < 0) lock_fd = open(STUDENT_FILE, O_RDWR | O_CREAT, 0644);
+        if (lock_fd < 0 || !file_lock(lock_fd, 0, STUDENT_HEADER_SIZE, FILE_LOCK_EXCLUSIVE)) break;
+        if (file_is_current(lock_fd, STUDENT_FILE)) {
+            ok = true;
+            break;
+        }
+        // Compacted underneath us; closing drops the stale lock
+        close(lock_fd);
+        lock_fd = -1;
+    }
+
+    ok = ok && student_store_refresh();
+    if (!ok) {
+        log_message(LOG_ERROR, "Failed to lock student file for writing");
+        student_store_unlock();
+    }
+    return ok;
+}
+
+void student_store_unlock(void) {
+    if (lock_depth == 0) return;
+    if (--lock_depth == 0) file_unlock(lock_fd, 0, STUDENT_HEADER_SIZE);
+    pthread_mutex_unlock(&writer_mutex);
+}
+
+// Compute the header that results from writing student at recno
+bool student_store_next_header(long recno, const Student *student, StudentStoreHeader *out) {
+    if (!student || recno < 0 || !out) return false;
+
+    *out = *student_store_header();
+    const Student *old = student_store_at((size_t)recno);
+    if (old) {
+        count_record(out, old, -1);
+    } else if (recno + 1 > out->record_count) {
+        out->record_count = recno + 1;
+    }
+    count_record(out, student, 1);
+    out->generation++;
+    return true;
+}
+
+// Write a full record, its summary and (unless NULL) the new header. This
+// is the only place the student file is written record by record, for
+// both normal mutations and journal replay.
+bool student_store_apply(long recno, const Student *student, const StudentStoreHeader *header) {
+    if (!student || recno < 0 || !open_cold_writer()) return false;
+
+    off_t offset = STUDENT_HEADER_SIZE + (off_t)recno * (off_t)sizeof(Student);
+    if (pwrite(cold_write_fd, student, sizeof(Student), offset) != (ssize_t)sizeof(Student)) {
+        log_message(LOG_ERROR, "Failed to write student record %ld", recno);
+        return false;
+    }
+    if (header && !write_header(cold_write_fd, header)) {
+        log_message(LOG_ERROR, "Failed to write student file header");
+        return false;
+    }
+    if (!student_store_write_summary(recno, student)) return false;
+    return refresh_file(&cold) && refresh_file(&hot);
+}
+
+// Recount the header from the records, for after bulk appends
+bool student_store_rebuild_header(void) {
+    if (!refresh_file(&cold) || !cold.base || !open_cold_writer()) return false;
+
+    const StudentStoreHeader *current = student_store_header();
+    StudentStoreHeader h;
+    init_header(&h);
+    if (current->next_id > h.next_id) h.next_id = current->next_id;
+    h.generation = current->generation + 1;
+
+    const Student *records = cold_records();
+    for (size_t i = 0; i < cold.count; i++) {
+        count_record(&h, &records[i], 1);
+    }
+    h.record_count = (int64_t)cold.count;
+
+    if (!write_header(cold_write_fd, &h)) {
+        log_message(LOG_ERROR, "Failed to write student file header");
+        return false;
+    }
+    log_message(LOG_INFO, "Recounted student file header (%zu records)", cold.count);
+    return true;
+}
+
+// Force the student file and summary table to disk
+bool student_store_sync(void) {
+    bool ok = true;
+    if (open_cold_writer()) ok = fdatasync(cold_write_fd) == 0 && ok;
+    if (open_hot_writer()) ok = fdatasync(hot_write_fd) == 0 && ok;
+    if (!ok) log_message(LOG_ERROR, "Failed to sync student files");
+    return ok;
+}
+
+// Rewrite the student file with only the records keep() accepts and swap it
+// in. Record numbers change, so the caller rebuilds every index afterwards.
+// The summary table is removed before the swap and rebuilt from whichever
+// student file is in place, so a crash at any point leaves a matching pair.
+bool student_store_compact(bool (*keep)(const Student *student, void *ctx), void *ctx,
+                           CompactionStats *stats) {
+    if (!student_store_refresh()) return false;
+
+    const char *tmp_path = STUDENT_FILE ".tmp";
+    size_t kept = 0;
+    if (!write_store_file(tmp_path, cold_records(), cold.count, keep, ctx,
+                          student_store_header(), &kept)) {
+        return false;
+    }
+
+    if (stats) {
+        stats->records_before = (long)cold.count;
+        stats->records_after = (long)kept;
+        stats->bytes_before = (long long)(cold.count * sizeof(Student));
+        stats->bytes_after = (long long)(kept * sizeof(Student));
+    }
+
+    if (unlink(STUDENT_HOT_FILE) != 0 && errno != ENOENT) {
+        unlink(tmp_path);
+        log_message(LOG_ERROR, "Failed to remove student summary table");
+        return false;
+    }
+    // Keep a descriptor on the file being replaced so it can be retired
+    if (!open_cold_writer() || !replace_file(tmp_path, STUDENT_FILE)) return false;
+
+    // Other processes may still map the old file and hold record numbers
+    // from it; the marker tells them without a system call
+    const uint32_t retired = STUDENT_STORE_RETIRED;
+    if (pwrite(cold_write_fd, &retired, sizeof(retired), offsetof(StudentStoreHeader, magic)) !=
+        (ssize_t)sizeof(retired)) {
+        log_message(LOG_WARNING, "Failed to mark replaced student file as retired");
+    }
+    return student_store_refresh();
+}
+
+// Identifies the mapped student file for callers that remember record
+// numbers: it changes whenever another file is mapped or the mapped one is
+// retired by a compaction, and is 0 when nothing usable is mapped. Reads
+// only the mapping, so it is cheap enough to check on every lookup.
+unsigned student_store_epoch(void) {
+    if (!cold.base || student_store_header()->magic != STUDENT_STORE_MAGIC) return 0;
+    return cold.opens;
+}
+
+StudentStoreStamp student_store_stamp(void) {
+    StudentStoreStamp stamp = {0, 0};
+    struct stat st;
+    if (stat(STUDENT_FILE, &st) != 0) return stamp;
+    stamp.size = (long long)st.st_size;
+
+    StudentStoreHeader h;
+    int fd = open(STUDENT_FILE, O_RDONLY);
+    if (fd >= 0) {
+        if (pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) && h.magic == STUDENT_STORE_MAGIC) {
+            stamp.generation = (long long)h.generation;
+        }
+        close(fd);
+    }
+    return stamp;
+}
+
+bool student_store_stamp_equal(StudentStoreStamp a, StudentStoreStamp b) {
+    return a.size == b.size && a.generation == b.generation;
+}
@@ -0,0 +1,456 @@
+#include "../include/student_text_index.h"
+#include "../include/student_store.h"
+#include "../include/bitmap.h"
+#include "../include/logger.h"
+
+#define TEXT_INDEX_MAGIC 0x47525453u  // "STRG"
+#define TEXT_INDEX_VERSION 1
+#define FIELD_TRIGRAMS_MAX 200        // A 100-byte field yields at most 150
+#define QUERY_TRIGRAMS_MAX 512
+#define TIE_SCAN_BUDGET 4096          // Tied candidates scored once the list is full
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t records;
+    uint32_t trigram_count;
+    StudentStoreStamp stamp;
+} TextIndexHeader;
+
+typedef struct {
+    uint32_t code;      // Three folded bytes; 0 marks a free slot
+    Bitmap bits;
+} TrigramPostings;
+
+// A search candidate being ranked
+typedef struct {
+    long recno;
+    double score;
+    double closeness;   // Trigram Jaccard similarity, breaks score ties
+    int field;          // Best field, name first; breaks remaining ties
+} RankedMatch;
+
+static TrigramPostings *table = NULL;  // Open addressing, power-of-two size
+static uint32_t table_size = 0;
+static uint32_t trigram_count = 0;
+static uint32_t record_total = 0;
+static bool loaded = false;
+static bool dirty = false;
+static uint64_t generation = 0;  // Student file generation the index reflects
+
+static bool is_word_byte(unsigned char c) {
+    return isalnum(c) || c >= 0x80;
+}
+
+// Append the trigrams of text (at most max bytes) to out, returning the new
+// count. Duplicates are kept; see unique_trigrams.
+static int extract_trigrams(const char *text, size_t max, uint32_t *out, int n, int cap) {
+    size_t i = 0;
+    while (i < max && text[i]) {
+        if (!is_word_byte((unsigned char)text[i])) {
+            i++;
+            continue;
+        }
+        // Slide a three-byte window over "  word "
+        uint32_t window = ((uint32_t)' ' << 8) | ' ';
+        for (; i < max && text[i] && is_word_byte((unsigned char)text[i]); i++) {
+            window = ((window << 8) | (uint32_t)tolower((unsigned char)text[i])) & 0xFFFFFF;
+            if (n < cap) out[n++] = window;
+        }
+        window = ((window << 8) | ' ') & 0xFFFFFF;
+        if (n < cap) out[n++] = window;
+    }
+    return n;
+}
+
+static int compare_codes(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Sort and drop duplicates, returning the distinct count. Single fields
+// are short enough that insertion sort beats qsort.
+static int unique_trigrams(uint32_t *codes, int n) {
+    if (n == 0) return 0;
+    if (n > 32) {
+        qsort(codes, n, sizeof(uint32_t), compare_codes);
+    } else {
+        for (int i = 1; i < n; i++) {
+            uint32_t code = codes[i];
+            int j = i;
+            for (; j > 0 && codes[j - 1] > code; j--) codes[j] = codes[j - 1];
+            codes[j] = code;
+        }
+    }
+    int m = 1;
+    for (int i = 1; i < n; i++) {
+        if (codes[i] != codes[m - 1]) codes[m++] = codes[i];
+    }
+    return m;
+}
+
+// Distinct trigrams of every indexed field of a student
+static int record_trigrams(const Student *s, uint32_t *out) {
+    int n = 0, cap = 4 * FIELD_TRIGRAMS_MAX;
+    n = extract_trigrams(s->name, sizeof(s->name), out, n, cap);
+    n = extract_trigrams(s->email, sizeof(s->email), out, n, cap);
+    n = extract_trigrams(s->school, sizeof(s->school), out, n, cap);
+    n = extract_trigrams(s->parent_name, sizeof(s->parent_name), out, n, cap);
+    return unique_trigrams(out, n);
+}
+
+static void reset_index(void) {
+    for (uint32_t i = 0; i < table_size; i++) {
+        if (table[i].code) bitmap_free(&table[i].bits);
+    }
+    free(table);
+    table = NULL;
+    table_size = trigram_count = record_total = 0;
+}
+
+static uint32_t slot_for(uint32_t code, uint32_t size) {
+    return (code * 2654435761u) & (size - 1);
+}
+
+static Bitmap* postings_find(uint32_t code) {
+    if (!table) return NULL;
+    for (uint32_t i = slot_for(code, table_size); table[i].code; i = (i + 1) & (table_size - 1)) {
+        if (table[i].code == code) return &table[i].bits;
+    }
+    return NULL;
+}
+
+static bool grow_table(void) {
+    uint32_t size = table_size ? table_size * 2 : 4096;
+    TrigramPostings *grown = calloc(size, sizeof(TrigramPostings));
+    if (!grown) return false;
+    for (uint32_t i = 0; i < table_size; i++) {
+        if (!table[i].code) continue;
+        uint32_t j = slot_for(table[i].code, size);
+        while (grown[j].code) j = (j + 1) & (size - 1);
+        grown[j] = table[i];
+    }
+    free(table);
+    table = grown;
+    table_size = size;
+    return true;
+}
+
+static Bitmap* postings_get(uint32_t code) {
+    Bitmap *bits = postings_find(code);
+    if (bits) return bits;
+
+    // Keep the load factor at or below one half
+    if ((trigram_count + 1) * 2 > table_size && !grow_table()) return NULL;
+    uint32_t i = slot_for(code, table_size);
+    while (table[i].code) i = (i + 1) & (table_size - 1);
+    table[i].code = code;
+    bitmap_init(&table[i].bits);
+    trigram_count++;
+    return &table[i].bits;
+}
+
+static bool index_record(uint32_t recno, const Student *s) {
+    uint32_t codes[4 * FIELD_TRIGRAMS_MAX];
+    int n = record_trigrams(s, codes);
+    for (int i = 0; i < n; i++) {
+        Bitmap *bits = postings_get(codes[i]);
+        if (!bits || !bitmap_add(bits, recno)) return false;
+    }
+    return true;
+}
+
+static void unindex_record(uint32_t recno, const Student *s) {
+    uint32_t codes[4 * FIELD_TRIGRAMS_MAX];
+    int n = record_trigrams(s, codes);
+    for (int i = 0; i < n; i++) {
+        Bitmap *bits = postings_find(codes[i]);
+        if (bits) bitmap_remove(bits, recno);
+    }
+}
+
+static bool rebuild_index(void) {
+    reset_index();
+    if (!student_store_refresh()) return false;
+    uint64_t built_from = student_store_header()->generation;
+
+    size_t total = student_store_count();
+    for (size_t i = 0; i < total; i++) {
+        const Student *s = student_store_at(i);
+        if (s && !index_record((uint32_t)i, s)) {
+            log_message(LOG_ERROR, "Memory allocation failed for text index");
+            reset_index();
+            return false;
+        }
+    }
+    record_total = (uint32_t)total;
+
+    dirty = true;
+    generation = built_from;
+    log_message(LOG_INFO, "Rebuilt student text index (%zu records, %u trigrams)", total, trigram_count);
+    return true;
+}
+
+static bool load_snapshot(void) {
+    FILE *fp = fopen(STUDENT_TEXT_INDEX_FILE, "rb");
+    if (!fp) return false;
+
+    TextIndexHeader hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+              hdr.magic == TEXT_INDEX_MAGIC && hdr.version == TEXT_INDEX_VERSION &&
+              student_store_stamp_equal(hdr.stamp, student_store_stamp());
+
+    for (uint32_t i = 0; ok && i < hdr.trigram_count; i++) {
+        uint32_t code;
+        Bitmap *bits;
+        ok = fread(&code, sizeof(code), 1, fp) == 1 && code != 0 &&
+             (bits = postings_get(code)) != NULL && bitmap_read(bits, fp);
+    }
+
+    if (ok) {
+        record_total = hdr.records;
+    } else {
+        reset_index();
+    }
+    fclose(fp);
+    return ok;
+}
+
+static void save_at_exit(void) {
+    student_text_index_save();
+}
+
+bool student_text_index_open(void) {
+    if (loaded) return true;
+
+    static bool exit_hook = false;
+    if (!exit_hook) {
+        atexit(save_at_exit);
+        exit_hook = true;
+    }
+
+    loaded = load_snapshot() || rebuild_index();
+    return loaded;
+}
+
+bool student_text_index_save(void) {
+    if (!loaded || !dirty) return true;
+
+    // Another process changed the student file after this index last
+    // caught up; leave the snapshot stale so the next open rebuilds
+    StudentStoreStamp stamp = student_store_stamp();
+    if ((uint64_t)stamp.generation != generation) return true;
+
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", STUDENT_TEXT_INDEX_FILE, (int)getpid());
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        log_message(LOG_ERROR, "Failed to create student text index file");
+        return false;
+    }
+
+    TextIndexHeader hdr = { TEXT_INDEX_MAGIC, TEXT_INDEX_VERSION, record_total,
+                            trigram_count, stamp };
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    for (uint32_t i = 0; ok && i < table_size; i++) {
+        if (!table[i].code) continue;
+        ok = fwrite(&table[i].code, sizeof(uint32_t), 1, fp) == 1 &&
+             bitmap_write(&table[i].bits, fp);
+    }
+
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, STUDENT_TEXT_INDEX_FILE) != 0) {
+        log_message(LOG_ERROR, "Failed to write student text index file");
+        remove(tmp_path);
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+// Drop the in-memory index after a bulk change; it is rebuilt on next use
+void student_text_index_invalidate(void) {
+    reset_index();
+    loaded = false;
+    dirty = false;
+}
+
+static bool same_text(const Student *a, const Student *b) {
+    return strcmp(a->name, b->name) == 0 && strcmp(a->email, b->email) == 0 &&
+           strcmp(a->school, b->school) == 0 && strcmp(a->parent_name, b->parent_name) == 0;
+}
+
+// old is NULL for a newly appended record. Only an index that is already
+// in memory is maintained incrementally.
+void student_text_index_update(long recno, const Student *old, const Student *updated) {
+    if (!loaded) return;
+
+    if (old && updated && same_text(old, updated)) return;
+    if (old) {
+        unindex_record((uint32_t)recno, old);
+    } else if ((uint32_t)recno >= record_total) {
+        record_total = (uint32_t)recno + 1;
+    }
+    if (updated && !index_record((uint32_t)recno, updated)) {
+        log_message(LOG_ERROR, "Memory allocation failed for text index");
+        reset_index();
+        loaded = false;
+        return;
+    }
+    dirty = true;
+    generation = student_store_header()->generation;
+}
+
+// Score one field against the sorted query trigrams: the share of query
+// trigrams it contains, and the Jaccard similarity of the two sets
+static void score_field(const char *text, size_t max, int field, const uint32_t *query, int nq,
+                        RankedMatch *m) {
+    uint32_t codes[FIELD_TRIGRAMS_MAX];
+    int nf = unique_trigrams(codes, extract_trigrams(text, max, codes, 0, FIELD_TRIGRAMS_MAX));
+
+    int shared = 0;
+    for (int i = 0, j = 0; i < nq && j < nf;) {
+        if (query[i] < codes[j]) i++;
+        else if (query[i] > codes[j]) j++;
+        else { shared++; i++; j++; }
+    }
+
+    double s = (double)shared / nq;
+    double c = (double)shared / (nq + nf - shared);
+    if (s > m->score || (s == m->score && c > m->closeness)) {
+        m->score = s;
+        m->closeness = c;
+        m->field = field;
+    }
+}
+
+static void score_student(const Student *st, const uint32_t *query, int nq, RankedMatch *m) {
+    m->score = m->closeness = 0;
+    m->field = 0;
+    score_field(st->name, sizeof(st->name), 0, query, nq, m);
+    score_field(st->email, sizeof(st->email), 1, query, nq, m);
+    score_field(st->school, sizeof(st->school), 2, query, nq, m);
+    score_field(st->parent_name, sizeof(st->parent_name), 3, query, nq, m);
+}
+
+static bool ranks_before(const RankedMatch *a, const RankedMatch *b) {
+    if (a->score != b->score) return a->score > b->score;
+    if (a->closeness != b->closeness) return a->closeness > b->closeness;
+    if (a->field != b->field) return a->field < b->field;
+    return a->recno < b->recno;
+}
+
+// Shared-trigram counts per record from the postings of each query trigram
+static uint16_t* count_shared(const uint32_t *query, int nq) {
+    uint16_t *shared = calloc(record_total > 0 ? record_total : 1, sizeof(uint16_t));
+    uint32_t *values = NULL;
+    uint32_t values_cap = 0;
+    if (!shared) return NULL;
+
+    for (int i = 0; i < nq; i++) {
+        const Bitmap *bits = postings_find(query[i]);
+        if (!bits) continue;
+        uint32_t n = bitmap_cardinality(bits);
+        if (n > values_cap) {
+            uint32_t *grown = realloc(values, n * sizeof(uint32_t));
+            if (!grown) {
+                free(values);
+                free(shared);
+                return NULL;
+            }
+            values = grown;
+            values_cap = n;
+        }
+        bitmap_to_array(bits, values);
+        for (uint32_t k = 0; k < n; k++) {
+            if (values[k] < record_total) shared[values[k]]++;
+        }
+    }
+    free(values);
+    return shared;
+}
+
+// The best matches for query across all indexed fields, best first, at most
+// limit of them. A record's shared-trigram count bounds the score of any of
+// its fields, so candidates are scored in descending count order and the
+// scan stops once no remaining one can beat the last listed score. Ties at
+// that score are still scored, up to TIE_SCAN_BUDGET of them, so closer
+// matches and name matches can move ahead.
+TextMatch* student_text_index_search(const char *query, int limit, int *count) {
+    if (count) *count = 0;
+    if (!query || limit <= 0 || !student_text_index_open()) return NULL;
+
+    uint32_t terms[QUERY_TRIGRAMS_MAX];
+    int nq = unique_trigrams(terms, extract_trigrams(query, strlen(query), terms, 0, QUERY_TRIGRAMS_MAX));
+    if (nq == 0) return calloc(1, sizeof(TextMatch));
+
+    uint16_t *shared = count_shared(terms, nq);
+    int min_shared = (int)(TEXT_MATCH_THRESHOLD * nq);
+    if (min_shared < TEXT_MATCH_THRESHOLD * nq) min_shared++;
+    if (min_shared < 1) min_shared = 1;
+
+    // Counting sort of the candidates by shared count, highest first
+    int *bucket_start = calloc((size_t)nq + 2, sizeof(int));
+    long *candidates = NULL;
+    int ncand = 0;
+    if (shared && bucket_start) {
+        for (uint32_t r = 0; r < record_total; r++) {
+            if (shared[r] >= min_shared) bucket_start[nq - shared[r] + 1]++;
+        }
+        for (int b = 1; b <= nq + 1; b++) bucket_start[b] += bucket_start[b - 1];
+        ncand = bucket_start[nq + 1];
+        candidates = malloc((ncand > 0 ? ncand : 1) * sizeof(long));
+        if (candidates) {
+            for (uint32_t r = 0; r < record_total; r++) {
+                if (shared[r] >= min_shared) candidates[bucket_start[nq - shared[r]]++] = r;
+            }
+        }
+    }
+
+    RankedMatch *best = malloc((size_t)limit * sizeof(RankedMatch));
+    TextMatch *matches = malloc((size_t)limit * sizeof(TextMatch));
+    if (!shared || !bucket_start || !candidates || !best || !matches) {
+        free(shared);
+        free(bucket_start);
+        free(candidates);
+        free(best);
+        free(matches);
+        log_message(LOG_ERROR, "Memory allocation failed for text search");
+        return NULL;
+    }
+
+    int found = 0, tie_budget = TIE_SCAN_BUDGET;
+    for (int i = 0; i < ncand; i++) {
+        long recno = candidates[i];
+        double bound = (double)shared[recno] / nq;
+        if (found == limit && bound <= best[found - 1].score) {
+            if (bound < best[found - 1].score || tie_budget-- == 0) break;
+        }
+
+        const Student *s = student_store_at((size_t)recno);
+        if (!s) continue;
+        RankedMatch m = { recno, 0, 0, 0 };
+        score_student(s, terms, nq, &m);
+        if (m.score < TEXT_MATCH_THRESHOLD) continue;
+        if (found == limit && !ranks_before(&m, &best[found - 1])) continue;
+
+        // Insert in rank order, dropping the last entry when full
+        int pos = found < limit ? found++ : found - 1;
+        while (pos > 0 && ranks_before(&m, &best[pos - 1])) {
+            best[pos] = best[pos - 1];
+            pos--;
+        }
+        best[pos] = m;
+    }
+
+    for (int i = 0; i < found; i++) {
+        matches[i].recno = best[i].recno;
+        matches[i].score = best[i].score;
+    }
+    free(shared);
+    free(bucket_start);
+    free(candidates);
+    free(best);
+    if (count) *count = found;
+    return matches;
+}
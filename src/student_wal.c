@@ -0,0 +1,222 @@
+#include "../include/student_wal.h"
+#include "../include/student_store.h"
+#include "../include/logger.h"
+#include <stddef.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define WAL_MAGIC 0x324c5753u  // "SWL2"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t op;
+    uint64_t lsn;
+    int64_t recno;
+    Student image;
+    StudentStoreHeader header;  // Store header after this change
+    uint32_t crc;        // CRC-32 of every field above
+} WalRecord;
+
+static int wal_fd = -1;
+static pthread_mutex_t wal_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wal_synced = PTHREAD_COND_INITIALIZER;
+static uint64_t next_lsn = 0;      // Last LSN handed out
+static uint64_t durable_lsn = 0;   // Every LSN up to here is on disk
+static bool sync_in_progress = false;
+static int active_writers = 0;     // Appended but not yet committed
+static unsigned commit_window_us = WAL_DEFAULT_COMMIT_WINDOW_US;
+static off_t wal_size = 0;
+
+static uint32_t crc32(const void *data, size_t len) {
+    static uint32_t table[256];
+    static bool table_ready = false;
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t record_crc(const WalRecord *rec) {
+    return crc32(rec, offsetof(WalRecord, crc));
+}
+
+void student_wal_set_commit_window(unsigned usec) {
+    pthread_mutex_lock(&wal_lock);
+    commit_window_us = usec;
+    pthread_mutex_unlock(&wal_lock);
+}
+
+static bool replay_journal(void) {
+    int fd = open(STUDENT_WAL_FILE, O_RDONLY);
+    if (fd < 0) return true;  // No journal, nothing to do
+
+    WalRecord rec;
+    size_t replayed = 0;
+    bool ok = true;
+    while (read(fd, &rec, sizeof(rec)) == (ssize_t)sizeof(rec)) {
+        if (rec.magic != WAL_MAGIC || rec.crc != record_crc(&rec)) break;
+        if (!student_store_apply(rec.recno, &rec.image, &rec.header)) {
+            ok = false;
+            break;
+        }
+        replayed++;
+    }
+    close(fd);
+
+    if (!ok) {
+        log_message(LOG_ERROR, "Student journal replay failed after %zu records", replayed);
+        return false;
+    }
+    if (!student_store_sync()) return false;
+    if (truncate(STUDENT_WAL_FILE, 0) != 0) {
+        log_message(LOG_ERROR, "Failed to truncate student journal");
+        return false;
+    }
+    if (replayed > 0) {
+        log_message(LOG_INFO, "Recovered %zu student journal records", replayed);
+    }
+    return true;
+}
+
+// Replay every intact record, force the student file and empty the journal.
+// A torn record at the tail (a crash mid-append) ends the replay. Runs under
+// the store's writer lock: other processes share the journal, and every
+// record they appended has been applied before they release the lock, so
+// replaying those again is harmless.
+bool student_wal_recover(void) {
+    if (!student_store_lock()) return false;
+    bool ok = replay_journal();
+    student_store_unlock();
+    return ok;
+}
+
+static void checkpoint_at_exit(void) {
+    student_wal_checkpoint();
+}
+
+bool student_wal_open(void) {
+    if (wal_fd >= 0) return true;
+    if (!student_wal_recover()) return false;
+
+    wal_fd = open(STUDENT_WAL_FILE, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (wal_fd < 0) {
+        log_message(LOG_ERROR, "Failed to open student journal");
+        return false;
+    }
+    wal_size = lseek(wal_fd, 0, SEEK_END);
+    atexit(checkpoint_at_exit);
+    return true;
+}
+
+// Append a record and return its LSN (0 on failure). The record is not
+// durable until student_wal_commit() returns for that LSN.
+uint64_t student_wal_append(int op, long recno, const Student *image,
+                            const StudentStoreHeader *header) {
+    if (!image || !header || !student_wal_open()) return 0;
+
+    WalRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = WAL_MAGIC;
+    rec.op = (uint32_t)op;
+    rec.recno = recno;
+    rec.image = *image;
+    rec.header = *header;
+
+    pthread_mutex_lock(&wal_lock);
+    rec.lsn = next_lsn + 1;
+    rec.crc = record_crc(&rec);
+    bool ok = write(wal_fd, &rec, sizeof(rec)) == (ssize_t)sizeof(rec);
+    if (ok) {
+        next_lsn = rec.lsn;
+        wal_size += (off_t)sizeof(rec);
+        active_writers++;
+    }
+    pthread_mutex_unlock(&wal_lock);
+
+    if (!ok) {
+        log_message(LOG_ERROR, "Failed to append to student journal");
+        return 0;
+    }
+    return rec.lsn;
+}
+
+// Block until lsn is durable. One caller at a time issues the fdatasync;
+// everyone whose record was appended before it started shares the result.
+bool student_wal_commit(uint64_t lsn) {
+    if (lsn == 0) return false;
+
+    pthread_mutex_lock(&wal_lock);
+    bool ok = true;
+    while (durable_lsn < lsn) {
+        if (sync_in_progress) {
+            pthread_cond_wait(&wal_synced, &wal_lock);
+            continue;
+        }
+
+        sync_in_progress = true;
+        if (active_writers > 1 && commit_window_us > 0) {
+            // Others are mid-flight; give them a moment to join this sync
+            pthread_mutex_unlock(&wal_lock);
+            usleep(commit_window_us);
+            pthread_mutex_lock(&wal_lock);
+        }
+        uint64_t target = next_lsn;
+        pthread_mutex_unlock(&wal_lock);
+
+        ok = fdatasync(wal_fd) == 0;
+
+        pthread_mutex_lock(&wal_lock);
+        sync_in_progress = false;
+        if (ok && target > durable_lsn) durable_lsn = target;
+        pthread_cond_broadcast(&wal_synced);
+        if (!ok) break;
+    }
+    active_writers--;
+    pthread_mutex_unlock(&wal_lock);
+
+    if (!ok) log_message(LOG_ERROR, "Failed to sync student journal");
+    return ok;
+}
+
+bool student_wal_needs_checkpoint(void) {
+    pthread_mutex_lock(&wal_lock);
+    bool needed = wal_size >= WAL_CHECKPOINT_BYTES;
+    pthread_mutex_unlock(&wal_lock);
+    return needed;
+}
+
+// Force the student file and start a fresh journal. Callers must make sure
+// every appended record has been applied to the student file first.
+bool student_wal_checkpoint(void) {
+    if (wal_fd < 0) return true;
+    if (!student_store_lock()) return false;
+
+    pthread_mutex_lock(&wal_lock);
+    while (sync_in_progress) pthread_cond_wait(&wal_synced, &wal_lock);
+
+    bool ok = student_store_sync() && ftruncate(wal_fd, 0) == 0;
+    if (ok) {
+        // Everything journaled so far is now durable in the student file
+        wal_size = 0;
+        durable_lsn = next_lsn;
+        pthread_cond_broadcast(&wal_synced);
+    }
+    pthread_mutex_unlock(&wal_lock);
+    student_store_unlock();
+
+    if (!ok) log_message(LOG_ERROR, "Student journal checkpoint failed");
+    return ok;
+}
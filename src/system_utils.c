@@ -1,7 +1,9 @@
 #include "../include/common.h"
+#include "../include/file_lock.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <fcntl.h>
 
 void ensure_dir_exists(const char *dir) {
     if (!FILE_EXISTS(dir)) {
@@ -9,6 +11,31 @@ void ensure_dir_exists(const char *dir) {
     }
 }
 
+// Atomically move a fully written and synced tmp_path over path, then sync
+// the directory so the rename itself survives a crash
+bool replace_file(const char *tmp_path, const char *path) {
+    if (rename(tmp_path, path) != 0) {
+        log_message(LOG_ERROR, "Failed to replace %s", path);
+        unlink(tmp_path);
+        return false;
+    }
+
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+    } else {
+        strcpy(dir, ".");
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+}
+
 SystemConfig load_system_config() {
     SystemConfig config = {0};
     FILE *fp = safe_open(CONFIG_FILE, "rb");
@@ -122,6 +149,8 @@ void show_documentation() {
 bool authenticate_user(const char *username, const char *password, User *user) {
     FILE *fp = safe_open(USER_FILE, "rb");
     if (!fp) return false;
+    // Readers share the lock; it only waits out a record being rewritten
+    file_lock(fileno(fp), 0, FILE_LOCK_RECORDS, FILE_LOCK_SHARED);
     
     User temp;
     bool found = false;
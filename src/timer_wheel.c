@@ -0,0 +1,103 @@
+#include "../include/timer_wheel.h"
+#include <string.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SPAN(level) ((uint64_t)1 << (TIMER_WHEEL_BITS * ((level) + 1)))
+#define MAX_DELTA (LEVEL_SPAN(TIMER_WHEEL_LEVELS - 1) - 1)
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+void timer_init(TimerEntry *timer, void (*fire)(TimerEntry *timer, void *arg)) {
+    memset(timer, 0, sizeof(*timer));
+    timer->fire = fire;
+}
+
+// Put timer in the slot for its expiry, or for earliest if that is later
+static void link_timer(TimerWheel *wheel, TimerEntry *timer, uint64_t earliest) {
+    uint64_t at = timer->expires > earliest ? timer->expires : earliest;
+    uint64_t delta = at - wheel->now;
+    if (delta > MAX_DELTA) {
+        delta = MAX_DELTA;
+        at = wheel->now + delta;
+    }
+
+    int level = 0;
+    while (delta >= LEVEL_SPAN(level)) level++;
+    TimerEntry **slot = &wheel->slots[level][(at >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK];
+
+    timer->next = *slot;
+    if (timer->next) timer->next->pprev = &timer->next;
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void unlink_timer(TimerEntry *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// Arm timer for tick expires, moving it if it was already pending
+void timer_wheel_add(TimerWheel *wheel, TimerEntry *timer, uint64_t expires) {
+    if (timer_pending(timer)) {
+        unlink_timer(timer);
+    } else {
+        wheel->pending++;
+    }
+    // Overdue timers fire on the next tick
+    timer->expires = expires;
+    link_timer(wheel, timer, wheel->now + 1);
+}
+
+void timer_wheel_cancel(TimerWheel *wheel, TimerEntry *timer) {
+    if (!timer_pending(timer)) return;
+    unlink_timer(timer);
+    wheel->pending--;
+}
+
+// Spread the level's current slot over the levels below, while the
+// current tick has yet to fire
+static void cascade(TimerWheel *wheel, int level) {
+    TimerEntry **slot = &wheel->slots[level][(wheel->now >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK];
+    TimerEntry *list = *slot;
+    *slot = NULL;
+    while (list) {
+        TimerEntry *timer = list;
+        list = timer->next;
+        link_timer(wheel, timer, wheel->now);
+    }
+}
+
+// Run the wheel forward to tick now, firing every timer that comes due.
+// A timer is unlinked before its fire() is called, which may add or
+// cancel any timer, itself included. Returns the number fired.
+size_t timer_wheel_advance(TimerWheel *wheel, uint64_t now, void *arg) {
+    size_t fired = 0;
+    while (wheel->now < now) {
+        // Nothing pending: jump straight there
+        if (wheel->pending == 0) {
+            wheel->now = now;
+            break;
+        }
+
+        wheel->now++;
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((wheel->now >> (TIMER_WHEEL_BITS * (level - 1))) & SLOT_MASK) break;
+            cascade(wheel, level);
+        }
+
+        TimerEntry **slot = &wheel->slots[0][wheel->now & SLOT_MASK];
+        while (*slot) {
+            TimerEntry *timer = *slot;
+            unlink_timer(timer);
+            wheel->pending--;
+            fired++;
+            timer->fire(timer, arg);
+        }
+    }
+    return fired;
+}
@@ -1,11 +1,52 @@
 #include "../include/user.h"
 #include "../include/common.h"
+#include "../include/file_lock.h"
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 
 // Global variables are declared extern in common.h and defined in main.c
 
+// Rewrite one user record in place. The record is found by scanning, then
+// locked on its own byte range and re-read before the change, so terminals
+// only wait for each other when they update the same user.
+static bool update_user_record(const char *username, void (*change)(User *user, const void *arg),
+                               const void *arg) {
+    int fd = open(USER_FILE, O_RDWR);
+    if (fd < 0) return false;
+
+    User temp;
+    bool updated = false;
+    for (off_t offset = 0; !updated && pread(fd, &temp, sizeof(User), offset) == (ssize_t)sizeof(User);
+         offset += (off_t)sizeof(User)) {
+        if (strcmp(temp.username, username) != 0) continue;
+        if (!file_lock(fd, offset, sizeof(User), FILE_LOCK_EXCLUSIVE)) break;
+        if (pread(fd, &temp, sizeof(User), offset) == (ssize_t)sizeof(User) &&
+            strcmp(temp.username, username) == 0) {
+            change(&temp, arg);
+            updated = pwrite(fd, &temp, sizeof(User), offset) == (ssize_t)sizeof(User);
+        }
+        file_unlock(fd, offset, sizeof(User));
+    }
+    close(fd);
+    return updated;
+}
+
+static void set_last_login(User *user, const void *arg) {
+    user->last_login = *(const time_t*)arg;
+}
+
+static void set_password(User *user, const void *arg) {
+    strncpy(user->password, arg, MAX_PASSWORD - 1);
+    user->password[MAX_PASSWORD - 1] = '\0';
+}
+
+bool record_user_login(const char *username) {
+    time_t now = time(NULL);
+    return username && update_user_record(username, set_last_login, &now);
+}
+
 bool login() {
     char username[MAX_USERNAME];
     char password[MAX_PASSWORD];
@@ -35,20 +76,7 @@ bool login() {
         secure_password_input(password, MAX_PASSWORD);
         
         if (authenticate_user(username, password, &current_user)) {
-            // Update last login time
-            FILE *user_fp = safe_open(USER_FILE, "r+b");
-            if (user_fp) {
-                User temp;
-                while (fread(&temp, sizeof(User), 1, user_fp) == 1) {
-                    if (strcmp(temp.username, username) == 0) {
-                        fseek(user_fp, -sizeof(User), SEEK_CUR);
-                        temp.last_login = time(NULL);
-                        fwrite(&temp, sizeof(User), 1, user_fp);
-                        break;
-                    }
-                }
-                fclose(user_fp);
-            }
+            record_user_login(username);
             
             is_logged_in = true;
             log_message(LOG_INFO, "User logged in: %s", username);
@@ -114,20 +142,8 @@ void change_password() {
     }
 
     // Update password in file
-    FILE *user_fp = safe_open(USER_FILE, "r+b");
-    if (user_fp) {
-        User temp;
-        while (fread(&temp, sizeof(User), 1, user_fp) == 1) {
-            if (strcmp(temp.username, current_user.username) == 0) {
-                fseek(user_fp, -sizeof(User), SEEK_CUR);
-                strcpy(temp.password, new_pass);
-                fwrite(&temp, sizeof(User), 1, user_fp);
-                strcpy(current_user.password, new_pass);
-                break;
-            }
-        }
-        fclose(user_fp);
-        
+    if (update_user_record(current_user.username, set_password, new_pass)) {
+        strcpy(current_user.password, new_pass);
         log_message(LOG_INFO, "Password changed for user: %s", current_user.username);
         
         set_color(COLOR_GREEN);
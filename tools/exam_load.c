@@ -0,0 +1,396 @@
+// Load generator for the exam server.
+//
+//   exam_load ADDRESS [connections] [exams-per-connection] [paper_id]
+//
+// Opens connections to a running `ems --exam-server ADDRESS` and drives
+// them all from one epoll loop, each sitting exams back to back: START,
+// then QUESTION and ANSWER for every question, then SUBMIT. Without a
+// paper_id it first adds a load test paper to ./data, so run it from the
+// server's working directory; on that paper it knows the right answers
+// and checks every SCORE the server returns. Each exam is sat by a
+// different active student from ./data, and load test students are added
+// when there are too few; on a given paper_id, students who have already
+// sat it are refused. Reports throughput and request latency.
+
+#define MAIN_FILE
+#include "../include/common.h"
+#include "../include/exam.h"
+#include "../include/scoring.h"
+#include "../include/student.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define LOAD_QUESTIONS 50
+#define LOAD_REPLY_MAX 2048
+#define LOAD_MAX_EVENTS 256
+#define LOAD_STUDENTS_PER_RUN 100000
+
+typedef struct {
+    int fd;
+    int student_id;
+    const int *students;      // Candidates for the exams left
+    int exams_left;
+    int num_questions;
+    int question;             // 1-based, in the candidate's order
+    bool answering;           // Waiting on ANSWER rather than QUESTION
+    bool done;
+    double expected;          // Score the answers given should earn
+    char in[LOAD_REPLY_MAX];
+    size_t in_len;
+    int64_t sent_us;
+    uint64_t rng;
+} Client;
+
+typedef struct {
+    bool checking;            // Answers are known, so scores can be checked
+    double negative_fraction;
+    int paper_id;
+    int *latencies_us;
+    size_t latency_count, latency_cap;
+    size_t exams, errors, mismatches;
+} LoadRun;
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint32_t next_random(Client *c) {
+    c->rng ^= c->rng << 13;
+    c->rng ^= c->rng >> 7;
+    c->rng ^= c->rng << 17;
+    return (uint32_t)(c->rng >> 32);
+}
+
+// A paper whose right option is always the one reading "right"
+static int seed_paper(void) {
+    ExamPaper *paper = create_new_paper("Load test paper", "General", 60);
+    if (!paper) return 0;
+    for (int q = 0; q < LOAD_QUESTIONS; q++) {
+        Question question;
+        memset(&question, 0, sizeof(question));
+        snprintf(question.text, sizeof(question.text), "Load test question %d: which option is right?", q + 1);
+        question.marks = 1 + q % 4;
+        question.difficulty = "EMH"[q % 3];
+        for (int j = 0; j < 4; j++) {
+            question.options[j].is_correct = (j == q % 4);
+            if (j == q % 4) snprintf(question.options[j].text, sizeof(question.options[j].text), "right");
+            else snprintf(question.options[j].text, sizeof(question.options[j].text), "wrong %d", j);
+        }
+        if (!add_question_to_paper(paper, &question)) {
+            free(paper);
+            return 0;
+        }
+    }
+    int paper_id = paper->paper_id;
+    free(paper);
+    return paper_id;
+}
+
+static int connect_to(const char *address) {
+    int fd;
+    if (strchr(address, '/')) {
+        struct sockaddr_un sun;
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        strncpy(sun.sun_path, address, sizeof(sun.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&sun, sizeof(sun)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        struct sockaddr_in sin;
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons((uint16_t)atoi(address));
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&sin, sizeof(sin)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Requests are short, so one write takes each whole
+static bool send_request(Client *c, const char *format, ...) {
+    char line[128];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+    line[n++] = '\n';
+    c->sent_us = now_us();
+    return send(c->fd, line, (size_t)n, MSG_NOSIGNAL) == n;
+}
+
+static void record_latency(LoadRun *run, int64_t us) {
+    if (run->latency_count == run->latency_cap) {
+        size_t cap = run->latency_cap ? run->latency_cap * 2 : 65536;
+        int *grown = realloc(run->latencies_us, cap * sizeof(int));
+        if (!grown) return;
+        run->latencies_us = grown;
+        run->latency_cap = cap;
+    }
+    run->latencies_us[run->latency_count++] = (int)us;
+}
+
+// Answer a QUESTION reply: mostly right, sometimes wrong, now and then skipped
+static bool answer_question(LoadRun *run, Client *c, const char *reply) {
+    int n, marks;
+    if (sscanf(reply, "QUESTION %d %d", &n, &marks) != 2) return false;
+    const char *options[4];
+    const char *p = reply;
+    for (int j = 0; j < 4; j++) {
+        p = strchr(p, '\t');
+        if (!p) return false;
+        options[j] = ++p;
+    }
+
+    uint32_t roll = next_random(c) % 10;
+    int right = -1;
+    for (int j = 0; j < 4; j++) {
+        if (strncmp(options[j], "right", 5) == 0 && (options[j][5] == '\t' || options[j][5] == '\0')) right = j;
+    }
+    int choice;
+    if (roll == 0) {
+        choice = -1;
+    } else if (roll < 8 || right < 0) {
+        choice = run->checking ? right : (int)(next_random(c) % 4);
+    } else {
+        choice = (right + 1 + (int)(next_random(c) % 3)) % 4;
+    }
+    if (run->checking && choice >= 0) {
+        c->expected += choice == right ? marks : -run->negative_fraction * marks;
+    }
+
+    c->answering = true;
+    return send_request(c, "ANSWER %d %c", n, choice < 0 ? '-' : 'A' + choice);
+}
+
+static bool start_next_exam(LoadRun *run, Client *c) {
+    if (c->exams_left == 0) return send_request(c, "QUIT");
+    c->exams_left--;
+    c->student_id = *c->students++;
+    c->expected = 0;
+    return send_request(c, "START %d %d", c->student_id, run->paper_id);
+}
+
+// Act on one reply line; false ends the client
+static bool handle_reply(LoadRun *run, Client *c, const char *reply) {
+    // Time warnings arrive between replies
+    if (strncmp(reply, "TIME ", 5) == 0) return true;
+    record_latency(run, now_us() - c->sent_us);
+
+    if (strncmp(reply, "ERR", 3) == 0) {
+        fprintf(stderr, "student %d: %s\n", c->student_id, reply);
+        run->errors++;
+        return false;
+    }
+    if (strcmp(reply, "BYE") == 0) {
+        c->done = true;
+        return false;
+    }
+    if (strncmp(reply, "QUESTION ", 9) == 0) return answer_question(run, c, reply);
+
+    double score;
+    if (sscanf(reply, "SCORE %lf", &score) == 1) {
+        run->exams++;
+        if (run->checking && fabs(score - c->expected) > 0.006) {
+            fprintf(stderr, "student %d: scored %.2f, expected %.2f\n", c->student_id, score, c->expected);
+            run->mismatches++;
+        }
+        return start_next_exam(run, c);
+    }
+
+    int session, questions;
+    if (sscanf(reply, "OK %d %d", &session, &questions) == 2) {
+        c->num_questions = questions;
+        c->question = 1;
+    } else if (strcmp(reply, "OK") == 0 && c->answering) {
+        c->question++;
+    } else {
+        fprintf(stderr, "student %d: unexpected reply: %s\n", c->student_id, reply);
+        run->errors++;
+        return false;
+    }
+
+    c->answering = false;
+    if (c->question > c->num_questions) return send_request(c, "SUBMIT");
+    return send_request(c, "QUESTION %d", c->question);
+}
+
+static bool read_replies(LoadRun *run, Client *c) {
+    ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+    if (n < 0) return errno == EAGAIN || errno == EINTR;
+    if (n == 0) return false;
+    c->in_len += (size_t)n;
+
+    size_t start = 0;
+    for (size_t i = 0; i < c->in_len; i++) {
+        if (c->in[i] != '\n') continue;
+        c->in[i] = '\0';
+        bool more = handle_reply(run, c, c->in + start);
+        start = i + 1;
+        if (!more) return false;
+    }
+    memmove(c->in, c->in + start, c->in_len - start);
+    c->in_len -= start;
+    return c->in_len < sizeof(c->in);
+}
+
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// IDs of needed active students, adding load test students to ./data
+// until there are enough
+static int *enrol_students(int needed) {
+    int *ids = malloc((size_t)needed * sizeof(int));
+    if (!ids) return NULL;
+    int count = 0, total = 0;
+    const Student *all = get_students(&total);
+    for (int i = 0; i < total && count < needed; i++) {
+        if (all[i].is_active) ids[count++] = all[i].id;
+    }
+    if (count < needed) printf("adding %d load test students\n", needed - count);
+    while (count < needed) {
+        Student s;
+        memset(&s, 0, sizeof(s));
+        snprintf(s.name, sizeof(s.name), "Load Test %d", count + 1);
+        snprintf(s.username, sizeof(s.username), "load%lx%d", (long)time(NULL), count + 1);
+        strcpy(s.grade, "LT");
+        if (!add_student(&s)) {
+            free(ids);
+            return NULL;
+        }
+        ids[count++] = s.id;
+    }
+    return ids;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s ADDRESS [connections] [exams-per-connection] [paper_id]\n", argv[0]);
+        return 2;
+    }
+    const char *address = argv[1];
+    int connections = argc > 2 ? atoi(argv[2]) : 1000;
+    int exams = argc > 3 ? atoi(argv[3]) : 1;
+    LoadRun run;
+    memset(&run, 0, sizeof(run));
+    run.paper_id = argc > 4 ? atoi(argv[4]) : 0;
+    if (connections < 1 || exams < 1 || (long)connections * exams > LOAD_STUDENTS_PER_RUN) {
+        fprintf(stderr, "connections x exams must be between 1 and %d\n", LOAD_STUDENTS_PER_RUN);
+        return 2;
+    }
+
+    if (run.paper_id == 0) {
+        initialize_exam_system();
+        run.paper_id = seed_paper();
+        if (run.paper_id == 0) {
+            fprintf(stderr, "failed to add a load test paper to ./data\n");
+            return 1;
+        }
+        run.checking = true;
+        run.negative_fraction = scoring_negative_fraction();
+        printf("load test paper %d (%d questions)\n", run.paper_id, LOAD_QUESTIONS);
+    }
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    int *students = enrol_students(connections * exams);
+    if (!students) {
+        fprintf(stderr, "failed to add load test students to ./data\n");
+        return 1;
+    }
+    Client *clients = calloc((size_t)connections, sizeof(Client));
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (!clients || epoll_fd < 0) return 1;
+
+    int64_t started = now_us();
+    int active = 0;
+    for (int i = 0; i < connections; i++) {
+        Client *c = &clients[i];
+        c->fd = connect_to(address);
+        if (c->fd < 0) {
+            fprintf(stderr, "connection %d to %s failed: %s\n", i + 1, address, strerror(errno));
+            run.errors++;
+            continue;
+        }
+        c->students = students + (size_t)i * exams;
+        c->exams_left = exams;
+        c->rng = 0x9e3779b97f4a7c15ull * (uint64_t)(i + 1);
+        struct epoll_event ev = { EPOLLIN, { .ptr = c } };
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+        if (start_next_exam(&run, c)) {
+            active++;
+        } else {
+            close(c->fd);
+            run.errors++;
+        }
+    }
+
+    struct epoll_event events[LOAD_MAX_EVENTS];
+    while (active > 0) {
+        int ready = epoll_wait(epoll_fd, events, LOAD_MAX_EVENTS, 10000);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) {
+            fprintf(stderr, "server stopped answering with %d connections open\n", active);
+            run.errors += (size_t)active;
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            Client *c = events[i].data.ptr;
+            if (!read_replies(&run, c)) {
+                if (!c->done && c->exams_left > 0) run.errors++;
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+                close(c->fd);
+                active--;
+            }
+        }
+    }
+    double seconds = (double)(now_us() - started) / 1e6;
+
+    qsort(run.latencies_us, run.latency_count, sizeof(int), compare_ints);
+    double mean = 0;
+    for (size_t i = 0; i < run.latency_count; i++) mean += run.latencies_us[i];
+    if (run.latency_count) mean /= (double)run.latency_count;
+    int p50 = run.latency_count ? run.latencies_us[run.latency_count / 2] : 0;
+    int p99 = run.latency_count ? run.latencies_us[run.latency_count * 99 / 100] : 0;
+    int worst = run.latency_count ? run.latencies_us[run.latency_count - 1] : 0;
+
+    printf("%d connections, %zu exams, %zu requests in %.2f s\n",
+           connections, run.exams, run.latency_count, seconds);
+    printf("%.0f requests/s, %.0f exams/s\n",
+           run.latency_count / seconds, run.exams / seconds);
+    printf("latency: mean %.0f us, p50 %d us, p99 %d us, max %d us\n", mean, p50, p99, worst);
+    printf("%zu errors", run.errors);
+    if (run.checking) printf(", %zu scores wrong", run.mismatches);
+    printf("\n");
+
+    free(run.latencies_us);
+    free(clients);
+    free(students);
+    close(epoll_fd);
+    return run.errors || run.mismatches ? 1 : 0;
+}
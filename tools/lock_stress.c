@@ -0,0 +1,379 @@
+// Multi-process stress test for the store locks.
+//
+//   lock_stress DIR [processes] [ops-per-process]
+//
+// Seeds a scratch data directory under DIR, then forks processes that mix
+// student, exam and user reads with writes against it, the way several
+// terminals would. Afterwards it checks that no write was lost or torn and
+// reports throughput. Never point it at a live data directory.
+
+#define MAIN_FILE
+#include "../include/common.h"
+#include "../include/student.h"
+#include "../include/student_store.h"
+#include "../include/student_wal.h"
+#include "../include/exam.h"
+#include "../include/question_bank.h"
+#include "../include/exam_schedule.h"
+#include "../include/user.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define SEED_STUDENTS 500
+#define SEED_PAPERS 20
+#define QUESTION_POOL 200
+#define SEED_USERS 50
+
+enum { OP_GET_STUDENT, OP_LOAD_PAPER, OP_AUTHENTICATE, OP_ADD_STUDENT, OP_UPDATE_STUDENT,
+       OP_SAVE_PAPER, OP_EDIT_QUESTIONS, OP_SCHEDULE_PAPER, OP_CREATE_PAPER, OP_USER_LOGIN, OP_COUNT };
+
+static const char *op_names[OP_COUNT] = {
+    "get student", "load paper", "authenticate", "add student", "update student",
+    "save paper", "edit questions", "schedule paper", "create paper", "user login"
+};
+
+// Per mille share of each operation; reads dominate, as at the terminals
+static const int op_weights[OP_COUNT] = { 390, 150, 150, 100, 100, 20, 20, 10, 10, 50 };
+
+typedef struct {
+    long done[OP_COUNT];
+    long failed[OP_COUNT];
+    double busy_ms;
+} WorkerStats;
+
+static double now_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+static void make_student(Student *s, int n) {
+    memset(s, 0, sizeof(*s));
+    snprintf(s->name, sizeof(s->name), "Stress Student %d", n);
+    snprintf(s->email, sizeof(s->email), "stress%d@example.com", n);
+    snprintf(s->phone, sizeof(s->phone), "555%07d", n);
+    snprintf(s->grade, sizeof(s->grade), "%d", 1 + n % 12);
+    snprintf(s->section, sizeof(s->section), "%c", 'A' + n % 4);
+}
+
+// Questions come from a small pool, so terminals keep adding ones the
+// question bank already holds
+static void make_question(Question *q, int n) {
+    memset(q, 0, sizeof(*q));
+    snprintf(q->text, sizeof(q->text), "Stress question %d?", n);
+    for (int i = 0; i < 4; i++) {
+        snprintf(q->options[i].text, sizeof(q->options[i].text), "Answer %d", i + 1);
+    }
+    q->options[n % 4].is_correct = true;
+    q->marks = 1 + n % 5;
+    q->difficulty = "EMH"[n % 3];
+}
+
+static void make_user(User *u, int n) {
+    memset(u, 0, sizeof(*u));
+    u->ID = n + 1;
+    snprintf(u->username, sizeof(u->username), "user%d", n);
+    snprintf(u->password, sizeof(u->password), "pass%d", n);
+    snprintf(u->name, sizeof(u->name), "Terminal User %d", n);
+    u->role = ROLE_EXAMINER;
+    u->active = true;
+    u->created_at = time(NULL);
+}
+
+// Runs in its own process, so the workers start without inherited state
+static int seed(void) {
+    ensure_dir_exists("data");
+
+    FILE *fp = fopen(USER_FILE, "wb");
+    if (!fp) return 1;
+    for (int i = 0; i < SEED_USERS; i++) {
+        User u;
+        make_user(&u, i);
+        fwrite(&u, sizeof(u), 1, fp);
+    }
+    fclose(fp);
+
+    for (int i = 0; i < SEED_STUDENTS; i++) {
+        Student s;
+        make_student(&s, i);
+        if (!add_student(&s)) return 1;
+    }
+    for (int i = 0; i < SEED_PAPERS; i++) {
+        char title[32];
+        snprintf(title, sizeof(title), "Paper %d", i);
+        ExamPaper *paper = create_new_paper(title, "Stress", 60);
+        if (!paper) return 1;
+        free(paper);
+    }
+    return 0;
+}
+
+static int pick_op(unsigned *rng) {
+    int r = rand_r(rng) % 1000;
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (r < op_weights[op]) return op;
+        r -= op_weights[op];
+    }
+    return OP_GET_STUDENT;
+}
+
+static bool run_op(int op, unsigned *rng, ExamPaper *paper) {
+    int max_student = student_store_header()->next_id - 1;
+    int student_id = 1 + rand_r(rng) % (max_student > 0 ? max_student : 1);
+    int user = rand_r(rng) % SEED_USERS;
+
+    switch (op) {
+    case OP_GET_STUDENT:
+        return get_student(student_id) != NULL;
+    case OP_LOAD_PAPER:
+        return load_exam_paper(1 + rand_r(rng) % SEED_PAPERS, paper);
+    case OP_AUTHENTICATE: {
+        User u, found;
+        make_user(&u, user);
+        return authenticate_user(u.username, u.password, &found) && found.ID == u.ID;
+    }
+    case OP_ADD_STUDENT: {
+        Student s;
+        make_student(&s, rand_r(rng));
+        return add_student(&s);
+    }
+    case OP_UPDATE_STUDENT: {
+        const Student *current = get_student(student_id);
+        if (!current) return false;
+        Student s = *current;
+        snprintf(s.phone, sizeof(s.phone), "556%07d", rand_r(rng) % 10000000);
+        return update_student(&s);
+    }
+    case OP_SAVE_PAPER:
+        if (!load_exam_paper(1 + rand_r(rng) % SEED_PAPERS, paper)) return false;
+        paper->duration_minutes = 30 + rand_r(rng) % 120;
+        return save_exam_paper(paper);
+    case OP_EDIT_QUESTIONS: {
+        if (!load_exam_paper(1 + rand_r(rng) % SEED_PAPERS, paper)) return false;
+        Question q;
+        make_question(&q, rand_r(rng) % QUESTION_POOL);
+        int r = rand_r(rng) % 4;
+        if (paper->num_questions == 0 || (r < 2 && paper->num_questions < MAX_QUESTIONS_PER_PAPER)) {
+            return add_question_to_paper(paper, &q);
+        }
+        int index = rand_r(rng) % paper->num_questions;
+        // A refusal because another terminal edited the paper first is fine
+        if (r == 2) {
+            return replace_question_in_paper(paper, index, &q) || load_exam_paper(paper->paper_id, paper);
+        }
+        return remove_question_from_paper(paper, index) || load_exam_paper(paper->paper_id, paper);
+    }
+    case OP_SCHEDULE_PAPER:
+        return assign_paper_to_date(1 + rand_r(rng) % SEED_PAPERS, time(NULL) + rand_r(rng) % (30 * 86400));
+    case OP_CREATE_PAPER: {
+        ExamPaper *created = create_new_paper("Stress extra", "Stress", 45);
+        free(created);
+        return created != NULL;
+    }
+    case OP_USER_LOGIN: {
+        User u;
+        make_user(&u, user);
+        return record_user_login(u.username);
+    }
+    }
+    return false;
+}
+
+static int work(int worker, int ops, WorkerStats *stats) {
+    unsigned rng = 0x9e3779b9u * (unsigned)(worker + 1);
+    ExamPaper *paper = malloc(sizeof(ExamPaper));
+    if (!paper) return 1;
+
+    double start = now_ms();
+    for (int i = 0; i < ops; i++) {
+        int op = pick_op(&rng);
+        if (run_op(op, &rng, paper)) {
+            stats->done[op]++;
+        } else {
+            stats->failed[op]++;
+        }
+    }
+    stats->busy_ms = now_ms() - start;
+    free(paper);
+    return 0;
+}
+
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Check the stores against what the workers reported doing
+static int verify(long added, long created) {
+    int problems = 0;
+    student_wal_recover();
+
+    int count = 0;
+    const Student *students = get_students(&count);
+    const StudentStoreHeader *h = student_store_header();
+    if (count != SEED_STUDENTS + added || h->record_count != count) {
+        printf("student count: %d in file, header says %lld, expected %ld\n",
+               count, (long long)h->record_count, SEED_STUDENTS + added);
+        problems++;
+    }
+
+    int *ids = malloc((count > 0 ? count : 1) * sizeof(int));
+    long active = 0;
+    int max_id = 0;
+    for (int i = 0; ids && i < count; i++) {
+        ids[i] = students[i].id;
+        if (ids[i] > max_id) max_id = ids[i];
+        if (students[i].is_active) active++;
+        const Student *s = get_student(ids[i]);
+        if (!s || s->id != ids[i]) {
+            printf("student %d not reachable through the ID index\n", ids[i]);
+            problems++;
+        }
+    }
+    if (ids) {
+        qsort(ids, count, sizeof(int), compare_ints);
+        for (int i = 1; i < count; i++) {
+            if (ids[i] == ids[i - 1]) {
+                printf("duplicate student ID %d\n", ids[i]);
+                problems++;
+            }
+        }
+        free(ids);
+    }
+    if (h->active_count != active || h->next_id <= max_id) {
+        printf("student header totals are off\n");
+        problems++;
+    }
+
+    ExamPaper *paper = malloc(sizeof(ExamPaper));
+    long papers = 0, dated = 0;
+    int32_t *days = calloc(SEED_PAPERS + created + 2, sizeof(int32_t));
+    for (int id = 1; paper && days && load_exam_paper(id, paper); id++) {
+        int marks = 0;
+        for (int i = 0; i < paper->num_questions; i++) marks += paper->questions[i].marks;
+        if (paper->paper_id != id || paper->total_marks != marks) {
+            printf("exam paper %d: total marks %d, questions add up to %d\n", id, paper->total_marks, marks);
+            problems++;
+        }
+        if (paper->is_active && paper->exam_date > 0 && id <= SEED_PAPERS + created) {
+            days[id] = exam_schedule_day(paper->exam_date);
+            dated++;
+        }
+        papers++;
+    }
+    free(paper);
+
+    // Every dated paper is in the calendar index under its day, and only those
+    int fd = open(EXAM_DATA_FILE, O_RDONLY), scheduled = 0;
+    ScheduleEntry *entries = fd >= 0 && days ? exam_schedule_load(fd, INT32_MIN, INT32_MAX - 1, &scheduled) : NULL;
+    bool schedule_ok = entries && scheduled == dated;
+    for (int i = 0; schedule_ok && i < scheduled; i++) {
+        int id = entries[i].paper_id;
+        schedule_ok = id >= 1 && id <= SEED_PAPERS + created && days[id] == entries[i].day;
+    }
+    if (!schedule_ok) {
+        printf("exam schedule: %d entries for %ld dated papers\n", scheduled, dated);
+        problems++;
+    }
+    free(entries);
+    free(days);
+    if (fd >= 0) close(fd);
+    struct stat st;
+    if (papers != SEED_PAPERS + created ||
+        (stat(EXAM_DATA_FILE, &st) == 0 && st.st_size != (off_t)(papers * (long)sizeof(PaperRecord)))) {
+        printf("exam papers: %ld with consecutive IDs, expected %ld\n", papers, SEED_PAPERS + created);
+        problems++;
+    }
+    if (question_bank_count() > QUESTION_POOL) {
+        printf("question bank: %d questions from a pool of %d\n", question_bank_count(), QUESTION_POOL);
+        problems++;
+    }
+
+    for (int i = 0; i < SEED_USERS; i++) {
+        User u, found;
+        make_user(&u, i);
+        if (!authenticate_user(u.username, u.password, &found) || found.ID != u.ID) {
+            printf("user %s damaged\n", u.username);
+            problems++;
+        }
+    }
+    if (stat(USER_FILE, &st) != 0 || st.st_size != (off_t)(SEED_USERS * sizeof(User))) {
+        printf("user file size changed\n");
+        problems++;
+    }
+    return problems;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s DIR [processes] [ops-per-process]\n", argv[0]);
+        return 2;
+    }
+    int procs = argc > 2 ? atoi(argv[2]) : 8;
+    int ops = argc > 3 ? atoi(argv[3]) : 2000;
+    if (procs < 1 || ops < 1) return 2;
+
+    ensure_dir_exists(argv[1]);
+    if (chdir(argv[1]) != 0) {
+        perror(argv[1]);
+        return 2;
+    }
+    if (FILE_EXISTS(STUDENT_FILE)) {
+        fprintf(stderr, "%s already holds student data; use an empty directory\n", argv[1]);
+        return 2;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) _exit(seed());
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "seeding failed\n");
+        return 1;
+    }
+
+    WorkerStats *stats = mmap(NULL, procs * sizeof(WorkerStats), PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED) return 1;
+    memset(stats, 0, procs * sizeof(WorkerStats));
+
+    double start = now_ms();
+    for (int w = 0; w < procs; w++) {
+        pid = fork();
+        if (pid == 0) _exit(work(w, ops, &stats[w]));
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+    }
+    int crashed = 0;
+    while ((pid = wait(&status)) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) crashed++;
+    }
+    double elapsed = now_ms() - start;
+
+    WorkerStats total;
+    memset(&total, 0, sizeof(total));
+    for (int w = 0; w < procs; w++) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            total.done[op] += stats[w].done[op];
+            total.failed[op] += stats[w].failed[op];
+        }
+    }
+
+    long all = 0;
+    printf("%d processes x %d ops in %.0f ms\n", procs, ops, elapsed);
+    for (int op = 0; op < OP_COUNT; op++) {
+        printf("  %-15s %8ld ok %6ld failed\n", op_names[op], total.done[op], total.failed[op]);
+        all += total.done[op] + total.failed[op];
+    }
+    printf("  %.0f ops/s overall\n", all / (elapsed / 1e3));
+
+    int problems = verify(total.done[OP_ADD_STUDENT], total.done[OP_CREATE_PAPER]) + crashed;
+    printf(problems ? "FAILED: %d problems\n" : "consistent\n", problems);
+    munmap(stats, procs * sizeof(WorkerStats));
+    return problems ? 1 : 0;
+}